@@ -0,0 +1,140 @@
+/*
+ * Block-buffered file writer with a background flush thread, shared by the
+ * exercise scripts for high-volume output (time series, packet traces).
+ * The simulation thread only appends into an in-memory block; full blocks are
+ * handed to a single writer thread, so disk I/O never stalls the event loop.
+ * Blocks are recycled through a free list, so steady-state writing does not
+ * allocate.
+ */
+
+#ifndef BACKGROUND_WRITER_H
+#define BACKGROUND_WRITER_H
+
+#include "ns3/abort.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+
+class BackgroundWriter
+{
+public:
+    explicit BackgroundWriter(size_t blockSize = 1 << 20)
+    : m_file(0), m_blockSize(blockSize), m_closing(false)
+    {}
+
+    ~BackgroundWriter() { Close(); }
+
+    bool IsOpen() const { return m_file != 0; }
+
+    void Open(const std::string& path)
+    {
+        NS_ABORT_MSG_IF(m_file, "BackgroundWriter: already open");
+        m_file = std::fopen(path.c_str(), "wb");
+        NS_ABORT_MSG_IF(!m_file, "BackgroundWriter: cannot open " << path);
+        m_closing = false;
+        m_active.reserve(m_blockSize);
+        m_thread = std::thread(&BackgroundWriter::Run, this);
+    }
+
+    void Write(const void* data, size_t len)
+    {
+        const char* bytes = static_cast<const char*>(data);
+        while (len > 0)
+        {
+            size_t room = m_blockSize - m_active.size();
+            size_t n = len < room ? len : room;
+            m_active.insert(m_active.end(), bytes, bytes + n);
+            bytes += n;
+            len -= n;
+            if (m_active.size() == m_blockSize) {
+                Submit();
+            }
+        }
+    }
+
+    void Write(const std::string& text) { Write(text.data(), text.size()); }
+
+    // Flushes the partial block, waits for the writer thread and closes the file
+    void Close()
+    {
+        if (!m_file) {
+            return;
+        }
+        if (!m_active.empty()) {
+            Submit();
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closing = true;
+        }
+        m_ready.notify_one();
+        m_thread.join();
+        std::fclose(m_file);
+        m_file = 0;
+    }
+
+private:
+    // Hands the active block to the writer thread and takes a recycled one
+    void Submit()
+    {
+        std::vector<char> next;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending.push_back(std::vector<char>());
+            m_pending.back().swap(m_active);
+            if (!m_free.empty()) {
+                next.swap(m_free.back());
+                m_free.pop_back();
+            }
+        }
+        m_ready.notify_one();
+        next.clear();
+        next.reserve(m_blockSize);
+        m_active.swap(next);
+    }
+
+    void Run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_ready.wait(lock, [this] { return m_closing || !m_pending.empty(); });
+            if (m_pending.empty()) {
+                return; // Closing and drained
+            }
+            std::vector<char> block;
+            block.swap(m_pending.front());
+            m_pending.pop_front();
+
+            lock.unlock();
+            std::fwrite(block.data(), 1, block.size(), m_file);
+            lock.lock();
+
+            block.clear();
+            m_free.push_back(std::vector<char>());
+            m_free.back().swap(block);
+        }
+    }
+
+    std::FILE* m_file;
+    size_t m_blockSize;
+    std::vector<char> m_active;                 // Owned by the simulation thread
+    std::deque<std::vector<char> > m_pending;   // Full blocks waiting for the writer
+    std::vector<std::vector<char> > m_free;     // Written blocks kept for reuse
+    std::mutex m_mutex;
+    std::condition_variable m_ready;
+    bool m_closing;
+    std::thread m_thread;
+};
+
+} // namespace ns3
+
+#endif /* BACKGROUND_WRITER_H */
@@ -0,0 +1,203 @@
+/*
+ * BFD-style liveness detection for point-to-point links (single hop, RFC 5880 in
+ * spirit). Each node runs one BfdLiveness application with a session per link:
+ * it sends a small UDP hello every Interval on every session and declares a
+ * session down once DetectMultiplier intervals pass without a hello from the
+ * peer. Both ends detect independently, so a cut link goes down on both sides.
+ * Like real BFD it only notifies its clients: a session going down or coming
+ * back up fires the StateChange trace, and the routing module connected to it
+ * moves traffic off or back onto the link. The Ipv4 interface stays up and
+ * hellos keep going out on a down session, so it comes back up as soon as the
+ * peer's hellos get through again.
+ *
+ * All sessions of a node share one periodic tick that sends the due hellos and
+ * checks the detection deadlines, so the event count is per node, not per session.
+ * Hellos leave with TTL 1 through a socket bound to the session's device, so they
+ * can never reach the peer over a detour.
+ */
+
+#ifndef BFD_LIVENESS_H
+#define BFD_LIVENESS_H
+
+#include "wan-topology.h"
+
+#include "ns3/applications-module.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+class BfdLiveness : public Application
+{
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::BfdLiveness")
+            .SetParent<Application>()
+            .SetGroupName("Applications")
+            .AddConstructor<BfdLiveness>()
+            .AddAttribute("Interval", "Hello transmit interval, also the detection tick",
+                          TimeValue(MilliSeconds(10)),
+                          MakeTimeAccessor(&BfdLiveness::m_interval),
+                          MakeTimeChecker(NanoSeconds(1)))
+            .AddAttribute("DetectMultiplier", "Hello intervals without a hello before a session is down",
+                          UintegerValue(3),
+                          MakeUintegerAccessor(&BfdLiveness::m_multiplier),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("Port", "UDP port of the hellos",
+                          UintegerValue(3784),
+                          MakeUintegerAccessor(&BfdLiveness::m_port),
+                          MakeUintegerChecker<uint16_t>())
+            .AddTraceSource("StateChange", "A session went down or came up",
+                            MakeTraceSourceAccessor(&BfdLiveness::m_stateTrace),
+                            "ns3::BfdLiveness::StateChangeCallback");
+        return tid;
+    }
+
+    typedef void (*StateChangeCallback)(Ptr<Node> node, uint32_t interface, bool up);
+
+    BfdLiveness() : m_multiplier(3), m_port(3784) {}
+
+    // One session over the link on interface, towards the peer's address on it
+    void AddSession(uint32_t interface, Ipv4Address peer)
+    {
+        Session session;
+        session.interface = interface;
+        session.peer = peer;
+        m_peerSessions[peer.Get()] = m_sessions.size();
+        m_sessions.push_back(session);
+    }
+
+    // One application per local topology node with a session on every link
+    static ApplicationContainer Install(const WanTopology& topo, Time interval, uint32_t multiplier)
+    {
+        std::unordered_map<uint32_t, Ptr<BfdLiveness> > apps;
+        ApplicationContainer container;
+        const NodeContainer& nodes = topo.GetNodes();
+        for (uint32_t i = 0; i < nodes.GetN(); ++i)
+        {
+            if (!topo.IsLocal(nodes.Get(i))) {
+                continue; // Simulated by another partition
+            }
+            Ptr<BfdLiveness> app = CreateObject<BfdLiveness>();
+            app->SetAttribute("Interval", TimeValue(interval));
+            app->SetAttribute("DetectMultiplier", UintegerValue(multiplier));
+            nodes.Get(i)->AddApplication(app);
+            apps[nodes.Get(i)->GetId()] = app;
+            container.Add(app);
+        }
+        for (uint32_t l = 0; l < topo.GetNLinks(); ++l)
+        {
+            NetDeviceContainer devices = topo.GetLinkDevices(topo.GetLinkName(l));
+            for (uint32_t side = 0; side < 2; ++side)
+            {
+                if (!apps.count(devices.Get(side)->GetNode()->GetId())) {
+                    continue;
+                }
+                Ptr<Ipv4> ipv4 = devices.Get(side)->GetNode()->GetObject<Ipv4>();
+                Ptr<Ipv4> peer = devices.Get(1 - side)->GetNode()->GetObject<Ipv4>();
+                uint32_t interface = ipv4->GetInterfaceForDevice(devices.Get(side));
+                uint32_t peerInterface = peer->GetInterfaceForDevice(devices.Get(1 - side));
+                apps[devices.Get(side)->GetNode()->GetId()]->AddSession(interface, peer->GetAddress(peerInterface, 0).GetLocal());
+            }
+        }
+        return container;
+    }
+
+protected:
+    virtual void DoDispose(void) override {
+        m_sessions.clear();
+        Application::DoDispose();
+    }
+
+private:
+    struct Session
+    {
+        uint32_t interface;
+        Ipv4Address peer;
+        Ptr<Socket> socket;
+        Time lastRx;
+        bool up = false;        // Comes up on the first hello from the peer
+        bool failed = false;    // Declared down at least once; later recoveries are reported
+    };
+
+    virtual void StartApplication(void) override {
+        Ptr<Ipv4> ipv4 = GetNode()->GetObject<Ipv4>();
+        for (Session& s : m_sessions)
+        {
+            s.socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+            s.socket->Bind(InetSocketAddress(ipv4->GetAddress(s.interface, 0).GetLocal(), m_port));
+            s.socket->BindToNetDevice(ipv4->GetNetDevice(s.interface));
+            s.socket->SetIpTtl(1);
+            s.socket->SetRecvCallback(MakeCallback(&BfdLiveness::HandleRead, this));
+        }
+        // Desynchronise the nodes' ticks within one interval
+        Ptr<UniformRandomVariable> offset = CreateObject<UniformRandomVariable>();
+        m_tick = Simulator::Schedule(Seconds(offset->GetValue(0.0, m_interval.GetSeconds())), &BfdLiveness::Tick, this);
+    }
+
+    virtual void StopApplication(void) override {
+        m_tick.Cancel();
+        for (Session& s : m_sessions)
+        {
+            if (s.socket) {
+                s.socket->Close();
+                s.socket = 0;
+            }
+        }
+    }
+
+    // The node's single timer: expire silent sessions, then send every hello,
+    // down sessions included, so a repaired link is detected
+    void Tick()
+    {
+        Time now = Simulator::Now();
+        Time detect = m_interval * m_multiplier;
+        for (Session& s : m_sessions)
+        {
+            if (s.up && now - s.lastRx > detect) {
+                s.up = false;
+                s.failed = true;
+                m_stateTrace(GetNode(), s.interface, false);
+            }
+            s.socket->SendTo(Create<Packet>(HELLO_SIZE), 0, InetSocketAddress(s.peer, m_port));
+        }
+        m_tick = Simulator::Schedule(m_interval, &BfdLiveness::Tick, this);
+    }
+
+    void HandleRead(Ptr<Socket> socket)
+    {
+        Ptr<Packet> packet;
+        Address from;
+        while ((packet = socket->RecvFrom(from)))
+        {
+            std::unordered_map<uint32_t, uint32_t>::const_iterator it =
+                m_peerSessions.find(InetSocketAddress::ConvertFrom(from).GetIpv4().Get());
+            if (it == m_peerSessions.end()) {
+                continue;
+            }
+            Session& s = m_sessions[it->second];
+            s.lastRx = Simulator::Now();
+            if (!s.up) {
+                s.up = true;
+                if (s.failed) {
+                    m_stateTrace(GetNode(), s.interface, true);
+                }
+            }
+        }
+    }
+
+    static constexpr uint32_t HELLO_SIZE = 24;      // BFD control packet without authentication
+
+    Time m_interval;
+    uint32_t m_multiplier;
+    uint16_t m_port;
+    std::vector<Session> m_sessions;
+    std::unordered_map<uint32_t, uint32_t> m_peerSessions;  // Peer address -> session
+    EventId m_tick;
+    TracedCallback<Ptr<Node>, uint32_t, bool> m_stateTrace;
+};
+
+} // namespace ns3
+
+#endif /* BFD_LIVENESS_H */
@@ -0,0 +1,395 @@
+/*
+ * Longest-prefix-match FIB routing protocol for large static route tables.
+ * Drop-in for Ipv4StaticRouting's AddNetworkRouteTo / AddHostRouteTo /
+ * SetDefaultRoute API, installed in the node's Ipv4ListRouting above static
+ * routing. Lookups walk a multibit trie with 8-bit strides (prefixes are
+ * expanded to the next stride boundary), so any address resolves in at most four
+ * table reads regardless of table size. The trie is rebuilt lazily from the
+ * route list after changes, so bulk loads (LoadRouteFile) compile once.
+ *
+ * Connected subnets are added from the interface addresses like static routing
+ * does. Routes through a down interface are kept but skipped until it comes back.
+ */
+
+#ifndef FIB_ROUTING_H
+#define FIB_ROUTING_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+class FibRouting : public Ipv4RoutingProtocol
+{
+public:
+    static constexpr uint32_t NO_ROUTE = 0xffffffff;
+    static constexpr uint32_t STRIDE = 256;     // Entries per trie node (8-bit stride)
+
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::FibRouting")
+            .SetParent<Ipv4RoutingProtocol>()
+            .SetGroupName("Internet")
+            .AddConstructor<FibRouting>();
+        return tid;
+    }
+
+    FibRouting() : m_dirty(true) {}
+
+    // Adds a FibRouting to the node's Ipv4ListRouting (static routing sits at 0)
+    static Ptr<FibRouting> Install(Ptr<Node> node, int16_t priority = 5)
+    {
+        Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(node->GetObject<Ipv4>()->GetRoutingProtocol());
+        NS_ABORT_MSG_IF(!list, "FibRouting: node " << node->GetId() << " is not using Ipv4ListRouting");
+        Ptr<FibRouting> fib = CreateObject<FibRouting>();
+        list->AddRoutingProtocol(fib, priority);
+        return fib;
+    }
+
+    // The FibRouting in a node's Ipv4ListRouting, or null
+    static Ptr<FibRouting> Get(Ptr<Ipv4> ipv4)
+    {
+        Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(ipv4->GetRoutingProtocol());
+        for (uint32_t i = 0; list && i < list->GetNRoutingProtocols(); ++i)
+        {
+            int16_t priority;
+            Ptr<FibRouting> fib = DynamicCast<FibRouting>(list->GetRoutingProtocol(i, priority));
+            if (fib) {
+                return fib;
+            }
+        }
+        return 0;
+    }
+
+    // --- Ipv4StaticRouting compatible configuration ---
+    void AddNetworkRouteTo(Ipv4Address network, Ipv4Mask mask, Ipv4Address nextHop, uint32_t interface, uint32_t metric = 0)
+    {
+        AddRoute(network, mask, nextHop, interface, metric, false);
+    }
+    void AddNetworkRouteTo(Ipv4Address network, Ipv4Mask mask, uint32_t interface, uint32_t metric = 0)
+    {
+        AddRoute(network, mask, Ipv4Address::GetZero(), interface, metric, false);
+    }
+    void AddHostRouteTo(Ipv4Address dest, Ipv4Address nextHop, uint32_t interface, uint32_t metric = 0)
+    {
+        AddRoute(dest, Ipv4Mask::GetOnes(), nextHop, interface, metric, false);
+    }
+    void SetDefaultRoute(Ipv4Address nextHop, uint32_t interface, uint32_t metric = 0)
+    {
+        AddRoute(Ipv4Address::GetZero(), Ipv4Mask::GetZero(), nextHop, interface, metric, false);
+    }
+
+    // Removes the route with exactly this destination, next hop and interface; false if absent
+    bool RemoveNetworkRoute(Ipv4Address network, Ipv4Mask mask, Ipv4Address nextHop, uint32_t interface)
+    {
+        std::unordered_map<RouteKey, uint32_t, RouteKeyHash>::iterator it =
+            m_index.find(MakeKey(network.Get() & mask.Get(), mask.Get(), nextHop.Get(), interface));
+        if (it == m_index.end()) {
+            return false;
+        }
+        RemoveAt(it->second);
+        return true;
+    }
+
+    uint32_t GetNRoutes() const { return m_routes.size(); }
+    Ipv4RoutingTableEntry GetRoute(uint32_t i) const
+    {
+        const FibRoute& r = m_routes[i];
+        return Ipv4RoutingTableEntry::CreateNetworkRouteTo(Ipv4Address(r.dest), Ipv4Mask(r.mask), Ipv4Address(r.gateway), r.interface);
+    }
+    uint32_t GetMetric(uint32_t i) const { return m_routes[i].metric; }
+    void RemoveRoute(uint32_t i) { RemoveAt(i); }
+
+    // Bulk load: one "<prefix>/<len> <nextHop> <interface> [metric]" per line, '#' comments.
+    // Returns the number of routes added; the trie is compiled once on the next lookup.
+    uint32_t LoadRouteFile(const std::string& path)
+    {
+        std::ifstream in(path.c_str());
+        NS_ABORT_MSG_IF(!in.is_open(), "FibRouting: cannot open " << path);
+        m_routes.reserve(m_routes.size() + 1024);
+        std::string line;
+        uint32_t lineNo = 0, added = 0;
+        while (std::getline(in, line))
+        {
+            ++lineNo;
+            std::string::size_type hash = line.find('#');
+            if (hash != std::string::npos) {
+                line.erase(hash);
+            }
+            std::istringstream fields(line);
+            std::string prefix, nextHop;
+            uint32_t interface = 0, metric = 0;
+            if (!(fields >> prefix)) {
+                continue;
+            }
+            NS_ABORT_MSG_IF(!(fields >> nextHop >> interface), "FibRouting: " << path << ":" << lineNo << ": expected <prefix>/<len> <nextHop> <interface> [metric]");
+            fields >> metric;
+            std::string::size_type slash = prefix.find('/');
+            NS_ABORT_MSG_IF(slash == std::string::npos, "FibRouting: " << path << ":" << lineNo << ": prefix needs /len");
+            uint32_t len = std::stoul(prefix.substr(slash + 1));
+            NS_ABORT_MSG_IF(len > 32, "FibRouting: " << path << ":" << lineNo << ": bad prefix length");
+            NS_ABORT_MSG_IF(m_ipv4 && interface >= m_ipv4->GetNInterfaces(),
+                            "FibRouting: " << path << ":" << lineNo << ": no interface " << interface);
+            AddRoute(Ipv4Address(prefix.substr(0, slash).c_str()), Ipv4Mask(LenToMask(len)),
+                     Ipv4Address(nextHop.c_str()), interface, metric, false);
+            ++added;
+        }
+        return added;
+    }
+
+    // Index of the longest matching usable route, or NO_ROUTE
+    uint32_t Lookup(Ipv4Address dest)
+    {
+        if (m_dirty) {
+            Compile();
+        }
+        uint32_t addr = dest.Get();
+        uint32_t best = NO_ROUTE, node = 0;
+        for (uint32_t shift = 24; ; shift -= 8)
+        {
+            const TrieEntry& e = m_trie[node * STRIDE + ((addr >> shift) & 0xff)];
+            if (e.route != NO_ROUTE) {
+                best = e.route;
+            }
+            if (e.child == 0 || shift == 0) {
+                return best;
+            }
+            node = e.child;
+        }
+    }
+
+    // Required overrides
+    virtual void SetIpv4(Ptr<Ipv4> ipv4) override {
+        m_ipv4 = ipv4;
+        for (uint32_t i = 0; i < ipv4->GetNInterfaces(); ++i)
+        {
+            for (uint32_t j = 0; j < ipv4->GetNAddresses(i); ++j)
+            {
+                NotifyAddAddress(i, ipv4->GetAddress(i, j));
+            }
+        }
+    }
+    virtual void NotifyInterfaceUp(uint32_t interface) override { Invalidate(); }
+    virtual void NotifyInterfaceDown(uint32_t interface) override { Invalidate(); }
+    virtual void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override {
+        Ipv4Mask mask = address.GetMask();
+        if (address.GetLocal() != Ipv4Address() && mask != Ipv4Mask()) {
+            AddRoute(address.GetLocal().CombineMask(mask), mask, Ipv4Address::GetZero(), interface, 0, true);
+        }
+        Invalidate();
+    }
+    virtual void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override {
+        Ipv4Mask mask = address.GetMask();
+        RemoveNetworkRoute(address.GetLocal().CombineMask(mask), mask, Ipv4Address::GetZero(), interface);
+        Invalidate();
+    }
+
+    virtual Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p, const Ipv4Header& header,
+                                       Ptr<NetDevice> oif, Socket::SocketErrno& sockerr) override {
+        Ptr<Ipv4Route> route = RouteTo(header.GetDestination());
+        if (route && oif && route->GetOutputDevice() != oif) {
+            route = 0; // Bound socket on another device: leave it to the next protocol
+        }
+        sockerr = route ? Socket::ERROR_NOTERROR : Socket::ERROR_NOROUTETOHOST;
+        return route;
+    }
+
+    // Transit path; Ipv4ListRouting has already handled local delivery
+    virtual bool RouteInput(Ptr<const Packet> p, const Ipv4Header& header, Ptr<const NetDevice> idev,
+                            UnicastForwardCallback ucb, MulticastForwardCallback mcb,
+                            LocalDeliverCallback lcb, ErrorCallback ecb) override {
+        if (header.GetDestination().IsMulticast() || header.GetDestination().IsBroadcast()) {
+            return false;
+        }
+        Ptr<Ipv4Route> route = RouteTo(header.GetDestination());
+        if (!route) {
+            return false;
+        }
+        ucb(route, p, header);
+        return true;
+    }
+
+    virtual void PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const override {
+        std::ostream* os = stream->GetStream();
+        *os << "FibRouting Table: " << m_routes.size() << " routes, " << m_trie.size() / STRIDE << " trie nodes" << std::endl;
+        for (const FibRoute& r : m_routes)
+        {
+            *os << "  " << Ipv4Address(r.dest) << "/" << r.len << " via " << Ipv4Address(r.gateway)
+                << " if " << r.interface << " metric " << r.metric << (r.connected ? " (connected)" : "") << std::endl;
+        }
+    }
+
+private:
+    struct FibRoute
+    {
+        uint32_t dest;
+        uint32_t mask;
+        uint32_t len;
+        uint32_t gateway;
+        uint32_t interface;
+        uint32_t metric;
+        bool connected;
+        Ptr<Ipv4Route> route;   // Built on first use; reset when the trie is recompiled
+    };
+
+    struct TrieEntry
+    {
+        uint32_t route = NO_ROUTE;
+        uint32_t child = 0;     // Node 0 is the root, so 0 means no child
+    };
+
+    struct RouteKey
+    {
+        uint32_t dest, mask, gateway, interface;
+        bool operator==(const RouteKey& o) const
+        {
+            return dest == o.dest && mask == o.mask && gateway == o.gateway && interface == o.interface;
+        }
+    };
+
+    struct RouteKeyHash
+    {
+        size_t operator()(const RouteKey& k) const
+        {
+            uint64_t h = (static_cast<uint64_t>(k.dest) << 32 | k.mask) * 0x9e3779b97f4a7c15ULL;
+            h ^= (static_cast<uint64_t>(k.gateway) << 32 | k.interface) + (h << 6) + (h >> 2);
+            return static_cast<size_t>(h);
+        }
+    };
+
+    static uint32_t LenToMask(uint32_t len) { return len == 0 ? 0 : (0xffffffffu << (32 - len)); }
+    static RouteKey MakeKey(uint32_t dest, uint32_t mask, uint32_t gateway, uint32_t interface)
+    {
+        RouteKey k = { dest, mask, gateway, interface };
+        return k;
+    }
+
+    void Invalidate() { m_dirty = true; }
+
+    void AddRoute(Ipv4Address network, Ipv4Mask mask, Ipv4Address nextHop, uint32_t interface, uint32_t metric, bool connected)
+    {
+        FibRoute r;
+        r.mask = mask.Get();
+        r.len = mask.GetPrefixLength();
+        NS_ABORT_MSG_IF(r.mask != LenToMask(r.len), "FibRouting: non-contiguous mask " << mask);
+        NS_ABORT_MSG_IF(m_ipv4 && interface >= m_ipv4->GetNInterfaces(), "FibRouting: no interface " << interface);
+        r.dest = network.Get() & r.mask;
+        r.gateway = nextHop.Get();
+        r.interface = interface;
+        r.metric = metric;
+        r.connected = connected;
+
+        RouteKey key = MakeKey(r.dest, r.mask, r.gateway, r.interface);
+        std::unordered_map<RouteKey, uint32_t, RouteKeyHash>::iterator it = m_index.find(key);
+        if (it != m_index.end()) {
+            m_routes[it->second].metric = metric; // Re-adding replaces the metric
+        } else {
+            m_index[key] = m_routes.size();
+            m_routes.push_back(r);
+        }
+        Invalidate();
+    }
+
+    // Swap-with-last removal keeps the route list dense
+    void RemoveAt(uint32_t i)
+    {
+        const FibRoute& r = m_routes[i];
+        m_index.erase(MakeKey(r.dest, r.mask, r.gateway, r.interface));
+        if (i + 1 != m_routes.size()) {
+            m_routes[i] = m_routes.back();
+            const FibRoute& moved = m_routes[i];
+            m_index[MakeKey(moved.dest, moved.mask, moved.gateway, moved.interface)] = i;
+        }
+        m_routes.pop_back();
+        Invalidate();
+    }
+
+    // Rebuilds the trie from the usable routes. Shorter prefixes go in first and
+    // longer ones overwrite their expanded entries; among equal prefixes the lowest
+    // metric is inserted last and wins.
+    void Compile()
+    {
+        std::vector<uint32_t> order;
+        order.reserve(m_routes.size());
+        for (uint32_t i = 0; i < m_routes.size(); ++i)
+        {
+            m_routes[i].route = 0;
+            if (!m_ipv4 || m_ipv4->IsUp(m_routes[i].interface)) {
+                order.push_back(i);
+            }
+        }
+        std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            const FibRoute& ra = m_routes[a];
+            const FibRoute& rb = m_routes[b];
+            return ra.len != rb.len ? ra.len < rb.len : ra.metric > rb.metric;
+        });
+
+        m_trie.assign(STRIDE, TrieEntry());
+        for (uint32_t i : order)
+        {
+            Insert(m_routes[i], i);
+        }
+        m_dirty = false;
+    }
+
+    void Insert(const FibRoute& r, uint32_t index)
+    {
+        uint32_t depth = r.len == 0 ? 0 : (r.len - 1) / 8;
+        uint32_t node = 0;
+        for (uint32_t d = 0; d < depth; ++d)
+        {
+            uint32_t slot = node * STRIDE + ((r.dest >> (24 - 8 * d)) & 0xff);
+            if (m_trie[slot].child == 0) {
+                uint32_t child = m_trie.size() / STRIDE;
+                m_trie.resize(m_trie.size() + STRIDE);
+                m_trie[slot].child = child;
+            }
+            node = m_trie[slot].child;
+        }
+        // Expand the prefix over every entry of its stride it covers
+        uint32_t span = 8 * (depth + 1) - r.len;
+        uint32_t first = (r.dest >> (24 - 8 * depth)) & 0xff & ~((1u << span) - 1);
+        for (uint32_t b = first; b < first + (1u << span); ++b)
+        {
+            m_trie[node * STRIDE + b].route = index;
+        }
+    }
+
+    Ptr<Ipv4Route> RouteTo(Ipv4Address dest)
+    {
+        uint32_t index = Lookup(dest);
+        if (index == NO_ROUTE) {
+            return 0;
+        }
+        FibRoute& r = m_routes[index];
+        if (m_ipv4->GetNAddresses(r.interface) == 0) {
+            return 0;   // No source address to send from
+        }
+        if (!r.route) {
+            Ptr<Ipv4Route> route = Create<Ipv4Route>();
+            route->SetDestination(Ipv4Address(r.dest)); // Informational only; forwarding uses the gateway
+            route->SetSource(m_ipv4->GetAddress(r.interface, 0).GetLocal());
+            route->SetGateway(Ipv4Address(r.gateway));
+            route->SetOutputDevice(m_ipv4->GetNetDevice(r.interface));
+            r.route = route;
+        }
+        return r.route;
+    }
+
+    Ptr<Ipv4> m_ipv4;
+    std::vector<FibRoute> m_routes;
+    std::unordered_map<RouteKey, uint32_t, RouteKeyHash> m_index;
+    std::vector<TrieEntry> m_trie;      // Node k occupies [k * STRIDE, (k + 1) * STRIDE)
+    bool m_dirty;
+};
+
+} // namespace ns3
+
+#endif /* FIB_ROUTING_H */
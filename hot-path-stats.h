@@ -0,0 +1,176 @@
+/*
+ * Low-overhead counters for the per-packet paths of the exercise scripts, as a
+ * replacement for per-packet NS_LOG strings. Everything is a plain integer
+ * increment; nothing is formatted until a dump is requested.
+ *
+ *   LatencyHistogram   wall-clock cost of a code path in log2 nanosecond buckets
+ *   QueueCounters      enqueue / dequeue / drop counts of one queue disc
+ *   NodeQueueStats     the queue counters of every queue disc on one node
+ *
+ * Per-node structs are aligned to a cache line so the counters of different
+ * nodes never share one. In a distributed run NodeQueueStats::MergePartitions()
+ * sums the counters that each partition took on its own nodes.
+ */
+
+#ifndef HOT_PATH_STATS_H
+#define HOT_PATH_STATS_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include "partition-reduce.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+static constexpr size_t CACHE_LINE = 64;
+
+class LatencyHistogram
+{
+public:
+    static constexpr uint32_t BUCKETS = 32;     // Bucket b holds [2^(b-1), 2^b) ns
+
+    LatencyHistogram() : m_count(0), m_sum(0), m_buckets() {}
+
+    void Record(uint64_t ns)
+    {
+        uint32_t b = ns ? 64 - __builtin_clzll(ns) : 0;
+        ++m_buckets[b < BUCKETS ? b : BUCKETS - 1];
+        ++m_count;
+        m_sum += ns;
+    }
+
+    uint64_t GetCount() const { return m_count; }
+    double GetMean() const { return m_count ? static_cast<double>(m_sum) / m_count : 0.0; }
+
+    // Upper bound (ns) of the bucket holding quantile q
+    uint64_t GetQuantile(double q) const
+    {
+        uint64_t rank = static_cast<uint64_t>(q * m_count), seen = 0;
+        for (uint32_t b = 0; b < BUCKETS; ++b)
+        {
+            seen += m_buckets[b];
+            if (seen > rank) {
+                return b ? uint64_t(1) << b : 0;
+            }
+        }
+        return uint64_t(1) << (BUCKETS - 1);
+    }
+
+    void Print(std::ostream& os) const
+    {
+        os << m_count << " calls, mean " << GetMean() << " ns, p50 <" << GetQuantile(0.5) << " ns, p99 <"
+           << GetQuantile(0.99) << " ns";
+    }
+
+private:
+    uint64_t m_count;
+    uint64_t m_sum;
+    uint64_t m_buckets[BUCKETS];
+};
+
+// Times one scope into a histogram; a null histogram makes it a no-op
+class LatencyTimer
+{
+public:
+    explicit LatencyTimer(LatencyHistogram* histogram)
+    : m_histogram(histogram)
+    {
+        if (m_histogram) {
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~LatencyTimer()
+    {
+        if (m_histogram) {
+            m_histogram->Record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - m_start).count());
+        }
+    }
+
+private:
+    LatencyHistogram* m_histogram;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+struct alignas(CACHE_LINE) QueueCounters
+{
+    std::string name;
+    uint64_t enqueued = 0;
+    uint64_t dequeued = 0;
+    uint64_t dropped = 0;
+};
+
+class NodeQueueStats
+{
+public:
+    // Counts the root queue disc of every device of the node that has one
+    void Install(Ptr<Node> node)
+    {
+        Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer>();
+        for (uint32_t i = 0; tc && i < node->GetNDevices(); ++i)
+        {
+            Ptr<QueueDisc> qdisc = tc->GetRootQueueDiscOnDevice(node->GetDevice(i));
+            if (qdisc) {
+                std::ostringstream name;
+                name << "node " << node->GetId() << " dev " << i;
+                Install(qdisc, name.str());
+            }
+        }
+    }
+
+    void Install(Ptr<QueueDisc> qdisc, const std::string& name)
+    {
+        m_queues.push_back(QueueCounters());     // Deque: counters never move once traced
+        QueueCounters* counters = &m_queues.back();
+        counters->name = name;
+        qdisc->TraceConnectWithoutContext("Enqueue", MakeBoundCallback(&NodeQueueStats::Count, &counters->enqueued));
+        qdisc->TraceConnectWithoutContext("Dequeue", MakeBoundCallback(&NodeQueueStats::Count, &counters->dequeued));
+        qdisc->TraceConnectWithoutContext("Drop", MakeBoundCallback(&NodeQueueStats::Count, &counters->dropped));
+    }
+
+    // Every partition must have installed the same queue discs in the same order
+    void MergePartitions()
+    {
+        std::vector<uint64_t> counts;
+        for (const QueueCounters& q : m_queues)
+        {
+            counts.insert(counts.end(), {q.enqueued, q.dequeued, q.dropped});
+        }
+        PartitionReduce(counts.data(), counts.size(), PARTITION_SUM);
+        std::vector<uint64_t>::const_iterator count = counts.begin();
+        for (QueueCounters& q : m_queues)
+        {
+            q.enqueued = *count++;
+            q.dequeued = *count++;
+            q.dropped = *count++;
+        }
+    }
+
+    void Print(std::ostream& os) const
+    {
+        for (const QueueCounters& q : m_queues)
+        {
+            os << "  " << q.name << ": enqueued " << q.enqueued << ", dequeued " << q.dequeued << ", dropped "
+               << q.dropped << "\n";
+        }
+    }
+
+private:
+    static void Count(uint64_t* counter, Ptr<const QueueDiscItem>) { ++*counter; }
+
+    std::deque<QueueCounters> m_queues;
+};
+
+} // namespace ns3
+
+#endif /* HOT_PATH_STATS_H */
@@ -0,0 +1,636 @@
+/*
+ * Link-state routing for the WanTopology scripts.
+ * Every router keeps its own link-state database. An adjacency change is
+ * originated as a new LSA by the router that saw it and flooded hop by hop with
+ * the link delays. Each router then updates its shortest-path tree
+ * incrementally: a lost tree link only recomputes the subtree hanging off it,
+ * and a restored link only relaxes the nodes it brings closer. Routes to every
+ * link subnet, plus a /32 to every interface address so traffic heads for the
+ * router that owns it, are written into the router's FibRouting if it has one,
+ * otherwise into Ipv4StaticRouting. Only the prefixes whose next hop or cost
+ * changed are touched.
+ *
+ * An adjacency is used only when both ends advertise it (two-way check), so a
+ * failure seen on one end is honoured network-wide once its LSA arrives.
+ *
+ * In a partitioned (distributed) topology only the routers of the local system
+ * are simulated here. LSAs for a router on another system are sent as UDP
+ * packets over the link, so they cross the partition like any other traffic,
+ * and the interface state of a remote router is taken from its latest LSA.
+ */
+
+#ifndef LINK_STATE_ROUTING_H
+#define LINK_STATE_ROUTING_H
+
+#include "fib-routing.h"
+#include "wan-topology.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+class LinkStateRouting
+{
+public:
+    static constexpr uint32_t INFINITE_COST = 0xffffffff;
+    static constexpr uint32_t NONE = 0xffffffff;
+
+    LinkStateRouting() : m_spfRuns(0), m_nodesRecomputed(0), m_routeChanges(0) {}
+
+    // Takes every link of the topology as a point-to-point adjacency; call after loading
+    void Install(const WanTopology& topo, uint32_t cost = 1)
+    {
+        const NodeContainer& nodes = topo.GetNodes();
+        for (uint32_t i = 0; i < nodes.GetN(); ++i)
+        {
+            Ptr<Node> node = nodes.Get(i);
+            m_routerIds[node->GetId()] = m_routers.size();
+            m_nodes.Add(node);
+            Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+            Router router;
+            router.local = topo.IsLocal(node);
+            router.fib = FibRouting::Get(ipv4);
+            if (!router.fib) {
+                router.staticRouting = Ipv4StaticRoutingHelper().GetStaticRouting(ipv4);
+                NS_ABORT_MSG_IF(!router.staticRouting, "LinkStateRouting: node " << node->GetId() << " has no static routing");
+            }
+            m_routers.push_back(router);
+        }
+
+        for (uint32_t id = 0; id < topo.GetNLinks(); ++id)
+        {
+            const std::string& name = topo.GetLinkName(id);
+            NetDeviceContainer devices = topo.GetLinkDevices(name);
+            LsLink link;
+            link.subnet = topo.GetSubnet(name);
+            link.mask = topo.GetSubnetMask(name);
+            link.cost = cost;
+            TimeValue delay;
+            devices.Get(0)->GetChannel()->GetAttribute("Delay", delay);
+            link.delay = delay.Get();
+            for (uint32_t side = 0; side < 2; ++side)
+            {
+                Ptr<Node> node = devices.Get(side)->GetNode();
+                Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+                link.router[side] = m_routerIds.at(node->GetId());
+                link.ifIndex[side] = ipv4->GetInterfaceForDevice(devices.Get(side));
+                link.address[side] = ipv4->GetAddress(link.ifIndex[side], 0).GetLocal();
+                link.up[side] = ipv4->IsUp(link.ifIndex[side]);
+                Router& router = m_routers[link.router[side]];
+                router.links.push_back(id);
+                router.ifLinks[link.ifIndex[side]] = id;
+            }
+            m_linkIds[name] = id;
+            m_links.push_back(link);
+        }
+    }
+
+    // Cost of one link in both directions; set before Start()
+    void SetLinkCost(const std::string& link, uint32_t cost)
+    {
+        NS_ABORT_MSG_IF(!m_linkIds.count(link), "LinkStateRouting: unknown link '" << link << "'");
+        NS_ABORT_MSG_IF(cost == 0, "LinkStateRouting: link cost must be positive");
+        m_links[m_linkIds[link]].cost = cost;
+    }
+
+    // Every router starts with a converged database: full SPF once, then install all routes
+    void Start()
+    {
+        uint32_t n = m_routers.size();
+        for (uint32_t r = 0; r < n; ++r)
+        {
+            if (!m_routers[r].local) {
+                continue;
+            }
+            View& view = m_routers[r].view;
+            view.seq.assign(n, 0);
+            view.advertised.assign(m_links.size() * 2, 0);
+            for (uint32_t l = 0; l < m_links.size(); ++l)
+            {
+                view.advertised[2 * l] = m_links[l].up[0];
+                view.advertised[2 * l + 1] = m_links[l].up[1];
+            }
+            view.routes.assign(m_links.size() * 3, InstalledRoute());
+            FullSpf(r);
+            for (uint32_t p = 0; p < view.routes.size(); ++p)
+            {
+                UpdateRoute(r, p);
+            }
+        }
+        m_inSet.assign(n, 0);
+
+        // Adjacencies that cross the partition exchange LSAs as packets
+        for (uint32_t l = 0; l < m_links.size(); ++l)
+        {
+            LsLink& link = m_links[l];
+            for (uint32_t side = 0; side < 2; ++side)
+            {
+                if (!m_routers[link.router[side]].local || m_routers[link.router[1 - side]].local) {
+                    continue;
+                }
+                Ptr<Node> node = m_nodes.Get(link.router[side]);
+                link.socket = Socket::CreateSocket(node, UdpSocketFactory::GetTypeId());
+                link.socket->Bind(InetSocketAddress(link.address[side], LSA_PORT));
+                link.socket->BindToNetDevice(node->GetObject<Ipv4>()->GetNetDevice(link.ifIndex[side]));
+                link.socket->SetIpTtl(1);
+                link.socket->SetRecvCallback(MakeCallback(&LinkStateRouting::ReceivePacket, this));
+                m_peerLinks[link.address[1 - side].Get()] = l;
+            }
+        }
+    }
+
+    // Local adjacency change: the router owning the interface originates and floods a new LSA
+    void NotifyInterfaceDown(Ptr<Node> node, uint32_t interface) { SetInterfaceState(node, interface, false); }
+    void NotifyInterfaceUp(Ptr<Node> node, uint32_t interface) { SetInterfaceState(node, interface, true); }
+
+    uint32_t GetSpfRuns() const { return m_spfRuns; }
+    uint64_t GetNodesRecomputed() const { return m_nodesRecomputed; }
+    uint32_t GetRouteChanges() const { return m_routeChanges; }
+
+private:
+    struct LsLink
+    {
+        uint32_t router[2];
+        uint32_t ifIndex[2];
+        Ipv4Address address[2];
+        Ipv4Address subnet;
+        Ipv4Mask mask;
+        uint32_t cost;
+        Time delay;
+        bool up[2];             // Interface state at each end
+        Ptr<Socket> socket;     // Local end of an adjacency that crosses the partition
+    };
+
+    // Links an origin lists as up, flooded unchanged along the tree of copies
+    struct Lsa
+    {
+        uint32_t origin;
+        uint32_t seq;
+        std::vector<uint8_t> up;    // Parallel to the origin's Router::links
+    };
+
+    struct InstalledRoute
+    {
+        bool valid = false;
+        Ipv4Address nextHop;
+        uint32_t ifIndex = 0;
+        uint32_t metric = 0;
+
+        bool operator==(const InstalledRoute& o) const
+        {
+            return valid == o.valid && (!valid || (nextHop == o.nextHop && ifIndex == o.ifIndex && metric == o.metric));
+        }
+    };
+
+    // One router's link-state database and shortest-path tree
+    struct View
+    {
+        std::vector<uint32_t> seq;                  // Newest LSA sequence per origin
+        std::vector<uint8_t> advertised;            // [2 * link + side]: that side lists the link
+        std::vector<uint32_t> dist;
+        std::vector<uint32_t> parent;
+        std::vector<uint32_t> parentLink;
+        std::vector<uint32_t> firstLink;            // Link out of the root on the path
+        std::vector<std::vector<uint32_t> > children;
+        std::vector<InstalledRoute> routes;         // Per prefix, see UpdateRoute()
+    };
+
+    struct Router
+    {
+        Ptr<FibRouting> fib;
+        Ptr<Ipv4StaticRouting> staticRouting;   // Used when the router has no FIB
+        std::vector<uint32_t> links;
+        std::unordered_map<uint32_t, uint32_t> ifLinks;  // Interface -> link
+        uint32_t seq = 0;
+        bool local = true;      // Simulated by this process
+        View view;
+    };
+
+    typedef std::pair<uint32_t, uint32_t> HeapEntry;    // (dist, router)
+    typedef std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry> > Heap;
+
+    uint32_t Side(uint32_t link, uint32_t router) const { return m_links[link].router[0] == router ? 0 : 1; }
+    uint32_t Peer(uint32_t link, uint32_t router) const { return m_links[link].router[1 - Side(link, router)]; }
+    bool Usable(const View& v, uint32_t link) const { return v.advertised[2 * link] && v.advertised[2 * link + 1]; }
+
+    void SetInterfaceState(Ptr<Node> node, uint32_t interface, bool up)
+    {
+        uint32_t r = m_routerIds.at(node->GetId());
+        std::unordered_map<uint32_t, uint32_t>::const_iterator it = m_routers[r].ifLinks.find(interface);
+        if (it == m_routers[r].ifLinks.end()) {
+            return; // Not a topology link (e.g. loopback)
+        }
+        m_links[it->second].up[Side(it->second, r)] = up;
+
+        std::shared_ptr<Lsa> lsa = std::make_shared<Lsa>();
+        lsa->origin = r;
+        lsa->seq = ++m_routers[r].seq;
+        for (uint32_t l : m_routers[r].links)
+        {
+            lsa->up.push_back(m_links[l].up[Side(l, r)]);
+        }
+        Receive(r, lsa, NONE);
+    }
+
+    // LSA arrival (or local origination when fromLink is NONE)
+    void Receive(uint32_t r, std::shared_ptr<const Lsa> lsa, uint32_t fromLink)
+    {
+        View& v = m_routers[r].view;
+        if (lsa->seq <= v.seq[lsa->origin]) {
+            return; // Already seen; stops the flood
+        }
+        v.seq[lsa->origin] = lsa->seq;
+
+        std::vector<uint32_t> lost, restored, prefixes;
+        const std::vector<uint32_t>& originLinks = m_routers[lsa->origin].links;
+        for (uint32_t i = 0; i < originLinks.size(); ++i)
+        {
+            uint32_t l = originLinks[i];
+            if (!m_routers[lsa->origin].local) {
+                m_links[l].up[Side(l, lsa->origin)] = lsa->up[i]; // A remote end's state is only known from its LSAs
+            }
+            uint8_t& flag = v.advertised[2 * l + Side(l, lsa->origin)];
+            if (flag == lsa->up[i]) {
+                continue;
+            }
+            bool before = Usable(v, l);
+            flag = lsa->up[i];
+            bool after = Usable(v, l);
+            AddLinkPrefixes(l, prefixes);
+            if (before && !after) {
+                lost.push_back(l);
+            } else if (!before && after) {
+                restored.push_back(l);
+            }
+        }
+
+        std::vector<uint32_t> changed;
+        for (uint32_t l : lost)
+        {
+            RemoveEdge(r, l, changed);
+        }
+        for (uint32_t l : restored)
+        {
+            AddEdge(r, l, changed);
+        }
+        if (!lost.empty() || !restored.empty()) {
+            ++m_spfRuns;
+        }
+
+        // Routes can only move for prefixes attached to recomputed routers or re-advertised
+        for (uint32_t node : changed)
+        {
+            for (uint32_t l : m_routers[node].links)
+            {
+                AddLinkPrefixes(l, prefixes);
+            }
+        }
+        std::sort(prefixes.begin(), prefixes.end());
+        prefixes.erase(std::unique(prefixes.begin(), prefixes.end()), prefixes.end());
+        for (uint32_t p : prefixes)
+        {
+            UpdateRoute(r, p);
+        }
+
+        // Flood on every live adjacency except the one it came in on
+        for (uint32_t l : m_routers[r].links)
+        {
+            if (l == fromLink || !m_links[l].up[0] || !m_links[l].up[1]) {
+                continue;
+            }
+            if (m_routers[Peer(l, r)].local) {
+                Simulator::Schedule(m_links[l].delay, &LinkStateRouting::Receive, this, Peer(l, r), lsa, l);
+            } else {
+                SendLsa(l, *lsa);
+            }
+        }
+    }
+
+    // LSA wire format: origin, seq and link count (big-endian 32 bit), one byte per link
+    void SendLsa(uint32_t l, const Lsa& lsa)
+    {
+        const LsLink& link = m_links[l];
+        std::vector<uint8_t> bytes(12 + lsa.up.size());
+        uint32_t fields[3] = {lsa.origin, lsa.seq, static_cast<uint32_t>(lsa.up.size())};
+        for (uint32_t i = 0; i < 12; ++i)
+        {
+            bytes[i] = static_cast<uint8_t>(fields[i / 4] >> (24 - 8 * (i % 4)));
+        }
+        std::copy(lsa.up.begin(), lsa.up.end(), bytes.begin() + 12);
+        uint32_t peerSide = m_routers[link.router[0]].local ? 1 : 0;
+        link.socket->SendTo(Create<Packet>(bytes.data(), bytes.size()), 0,
+                            InetSocketAddress(link.address[peerSide], LSA_PORT));
+    }
+
+    void ReceivePacket(Ptr<Socket> socket)
+    {
+        Ptr<Packet> packet;
+        Address from;
+        while ((packet = socket->RecvFrom(from)))
+        {
+            std::unordered_map<uint32_t, uint32_t>::const_iterator it =
+                m_peerLinks.find(InetSocketAddress::ConvertFrom(from).GetIpv4().Get());
+            if (it == m_peerLinks.end() || packet->GetSize() < 12) {
+                continue;
+            }
+            std::vector<uint8_t> bytes(packet->GetSize());
+            packet->CopyData(bytes.data(), bytes.size());
+            uint32_t fields[3] = {0, 0, 0};
+            for (uint32_t i = 0; i < 12; ++i)
+            {
+                fields[i / 4] = (fields[i / 4] << 8) | bytes[i];
+            }
+            if (fields[0] >= m_routers.size() || bytes.size() != 12 + fields[2]) {
+                continue;
+            }
+            std::shared_ptr<Lsa> lsa = std::make_shared<Lsa>();
+            lsa->origin = fields[0];
+            lsa->seq = fields[1];
+            lsa->up.assign(bytes.begin() + 12, bytes.end());
+            const LsLink& link = m_links[it->second];
+            Receive(m_routers[link.router[0]].local ? link.router[0] : link.router[1], lsa, it->second);
+        }
+    }
+
+    void FullSpf(uint32_t r)
+    {
+        View& v = m_routers[r].view;
+        uint32_t n = m_routers.size();
+        v.dist.assign(n, INFINITE_COST);
+        v.parent.assign(n, NONE);
+        v.parentLink.assign(n, NONE);
+        v.firstLink.assign(n, NONE);
+        v.children.assign(n, std::vector<uint32_t>());
+
+        std::vector<uint8_t> done(n, 0);
+        Heap heap;
+        v.dist[r] = 0;
+        heap.push(HeapEntry(0, r));
+        while (!heap.empty())
+        {
+            uint32_t s = heap.top().second;
+            heap.pop();
+            if (done[s]) {
+                continue;
+            }
+            done[s] = 1;
+            Attach(v, r, s);
+            Relax(v, s, heap, 0);
+        }
+        ++m_spfRuns;
+        m_nodesRecomputed += n;
+    }
+
+    // A tree link failed: only the subtree behind it can get longer paths
+    void RemoveEdge(uint32_t r, uint32_t link, std::vector<uint32_t>& changed)
+    {
+        View& v = m_routers[r].view;
+        uint32_t a = m_links[link].router[0], b = m_links[link].router[1];
+        uint32_t child = (v.parentLink[b] == link && v.parent[b] == a) ? b
+                       : (v.parentLink[a] == link && v.parent[a] == b) ? a : NONE;
+        if (child == NONE) {
+            return; // Not on this router's tree: no distance changes
+        }
+
+        Detach(v, child);
+        std::vector<uint32_t> subtree(1, child);
+        for (uint32_t i = 0; i < subtree.size(); ++i)
+        {
+            subtree.insert(subtree.end(), v.children[subtree[i]].begin(), v.children[subtree[i]].end());
+        }
+
+        Heap heap;
+        for (uint32_t s : subtree)
+        {
+            m_inSet[s] = 1;
+            v.dist[s] = INFINITE_COST;
+            v.parent[s] = NONE;
+            v.parentLink[s] = NONE;
+            v.firstLink[s] = NONE;
+            v.children[s].clear();
+        }
+        // Seed each orphan from its best neighbour outside the subtree, whose path is intact
+        for (uint32_t s : subtree)
+        {
+            for (uint32_t l : m_routers[s].links)
+            {
+                uint32_t w = Peer(l, s);
+                if (Usable(v, l) && !m_inSet[w] && v.dist[w] != INFINITE_COST && v.dist[w] + m_links[l].cost < v.dist[s]) {
+                    v.dist[s] = v.dist[w] + m_links[l].cost;
+                    v.parent[s] = w;
+                    v.parentLink[s] = l;
+                }
+            }
+            if (v.dist[s] != INFINITE_COST) {
+                heap.push(HeapEntry(v.dist[s], s));
+            }
+        }
+        while (!heap.empty())
+        {
+            HeapEntry top = heap.top();
+            heap.pop();
+            uint32_t s = top.second;
+            if (m_inSet[s] != 1 || top.first != v.dist[s]) {
+                continue;
+            }
+            m_inSet[s] = 2;
+            Attach(v, r, s);
+            Relax(v, s, heap, 1);
+        }
+
+        for (uint32_t s : subtree)
+        {
+            m_inSet[s] = 0;
+        }
+        changed.insert(changed.end(), subtree.begin(), subtree.end());
+        m_nodesRecomputed += subtree.size();
+    }
+
+    // A link came back: only routers it brings strictly closer are updated
+    void AddEdge(uint32_t r, uint32_t link, std::vector<uint32_t>& changed)
+    {
+        View& v = m_routers[r].view;
+        Heap heap;
+        for (uint32_t side = 0; side < 2; ++side)
+        {
+            uint32_t u = m_links[link].router[side], w = m_links[link].router[1 - side];
+            if (v.dist[u] != INFINITE_COST && v.dist[u] + m_links[link].cost < v.dist[w]) {
+                Reparent(v, w, u, link, v.dist[u] + m_links[link].cost);
+                heap.push(HeapEntry(v.dist[w], w));
+            }
+        }
+        while (!heap.empty())
+        {
+            HeapEntry top = heap.top();
+            heap.pop();
+            uint32_t s = top.second;
+            if (top.first != v.dist[s]) {
+                continue;
+            }
+            v.firstLink[s] = v.parent[s] == r ? v.parentLink[s] : v.firstLink[v.parent[s]];
+            changed.push_back(s);
+            ++m_nodesRecomputed;
+            for (uint32_t l : m_routers[s].links)
+            {
+                uint32_t w = Peer(l, s);
+                if (Usable(v, l) && v.dist[s] + m_links[l].cost < v.dist[w]) {
+                    Reparent(v, w, s, l, v.dist[s] + m_links[l].cost);
+                    heap.push(HeapEntry(v.dist[w], w));
+                }
+            }
+        }
+    }
+
+    // Relaxes s's usable links; restrict = 1 limits updates to routers still open in m_inSet
+    void Relax(View& v, uint32_t s, Heap& heap, uint8_t restrict)
+    {
+        for (uint32_t l : m_routers[s].links)
+        {
+            uint32_t w = Peer(l, s);
+            if (!Usable(v, l) || (restrict && m_inSet[w] != 1)) {
+                continue;
+            }
+            uint32_t cand = v.dist[s] + m_links[l].cost;
+            if (cand < v.dist[w]) {
+                v.dist[w] = cand;
+                v.parent[w] = s;
+                v.parentLink[w] = l;
+                heap.push(HeapEntry(cand, w));
+            }
+        }
+    }
+
+    // s is final: hang it under its parent and inherit the first hop
+    void Attach(View& v, uint32_t r, uint32_t s)
+    {
+        if (s == r) {
+            return;
+        }
+        v.children[v.parent[s]].push_back(s);
+        v.firstLink[s] = v.parent[s] == r ? v.parentLink[s] : v.firstLink[v.parent[s]];
+    }
+
+    void Detach(View& v, uint32_t s)
+    {
+        if (v.parent[s] == NONE) {
+            return;
+        }
+        std::vector<uint32_t>& siblings = v.children[v.parent[s]];
+        std::vector<uint32_t>::iterator it = std::find(siblings.begin(), siblings.end(), s);
+        if (it != siblings.end()) {
+            *it = siblings.back();
+            siblings.pop_back();
+        }
+    }
+
+    void Reparent(View& v, uint32_t s, uint32_t parent, uint32_t link, uint32_t dist)
+    {
+        Detach(v, s);
+        v.dist[s] = dist;
+        v.parent[s] = parent;
+        v.parentLink[s] = link;
+        v.children[parent].push_back(s);
+    }
+
+    // Prefix p < L is the subnet of link p, reachable through either end; prefix
+    // L + 2 * link + side is the /32 of that end's address, reachable through its owner
+    void AddLinkPrefixes(uint32_t link, std::vector<uint32_t>& prefixes) const
+    {
+        uint32_t hosts = m_links.size() + 2 * link;
+        prefixes.push_back(link);
+        prefixes.push_back(hosts);
+        prefixes.push_back(hosts + 1);
+    }
+
+    // Recomputes router r's route to a prefix and rewrites it if it moved
+    void UpdateRoute(uint32_t r, uint32_t prefix)
+    {
+        View& v = m_routers[r].view;
+        uint32_t link = prefix, firstSide = 0, lastSide = 1;
+        if (prefix >= m_links.size()) {
+            link = (prefix - m_links.size()) / 2;
+            firstSide = lastSide = (prefix - m_links.size()) % 2;
+        }
+        const LsLink& target = m_links[link];
+        Ipv4Address dest = firstSide == lastSide ? target.address[firstSide] : target.subnet;
+        Ipv4Mask mask = firstSide == lastSide ? Ipv4Mask::GetOnes() : target.mask;
+        InstalledRoute want;
+
+        // A connected subnet needs no route, nor does r's own address on it; the
+        // far end's address still gets its host route
+        bool attached = false;
+        for (uint32_t side = firstSide; side <= lastSide; ++side)
+        {
+            attached = attached || (target.router[side] == r && target.up[side]);
+        }
+        if (!attached) {
+            uint32_t best = INFINITE_COST, via = NONE;
+            for (uint32_t side = firstSide; side <= lastSide; ++side)
+            {
+                uint32_t e = target.router[side];
+                if (v.advertised[2 * link + side] && e != r && v.dist[e] != INFINITE_COST && v.dist[e] + target.cost < best) {
+                    best = v.dist[e] + target.cost;
+                    via = v.firstLink[e];
+                }
+            }
+            if (via != NONE) {
+                uint32_t side = Side(via, r);
+                want.valid = true;
+                want.nextHop = m_links[via].address[1 - side];
+                want.ifIndex = m_links[via].ifIndex[side];
+                want.metric = best;
+            }
+        }
+
+        InstalledRoute& have = v.routes[prefix];
+        if (have == want) {
+            return;
+        }
+        Ptr<FibRouting> fib = m_routers[r].fib;
+        Ptr<Ipv4StaticRouting> routing = m_routers[r].staticRouting;
+        if (have.valid && fib) {
+            fib->RemoveNetworkRoute(dest, mask, have.nextHop, have.ifIndex);
+        } else if (have.valid) {
+            for (uint32_t i = 0; i < routing->GetNRoutes(); ++i)
+            {
+                Ipv4RoutingTableEntry entry = routing->GetRoute(i);
+                if (entry.GetDestNetwork() == dest && entry.GetDestNetworkMask() == mask &&
+                    entry.GetGateway() == have.nextHop && entry.GetInterface() == have.ifIndex) {
+                    routing->RemoveRoute(i);
+                    break;
+                }
+            }
+        }
+        if (want.valid && fib) {
+            fib->AddNetworkRouteTo(dest, mask, want.nextHop, want.ifIndex, want.metric);
+        } else if (want.valid) {
+            routing->AddNetworkRouteTo(dest, mask, want.nextHop, want.ifIndex, want.metric);
+        }
+        have = want;
+        ++m_routeChanges;
+    }
+
+    static constexpr uint16_t LSA_PORT = 5200;
+
+    std::vector<Router> m_routers;
+    NodeContainer m_nodes;                                  // Router index -> node
+    std::unordered_map<uint32_t, uint32_t> m_peerLinks;     // Remote peer address -> link
+    std::unordered_map<uint32_t, uint32_t> m_routerIds;     // Node id -> router
+    std::vector<LsLink> m_links;
+    std::unordered_map<std::string, uint32_t> m_linkIds;
+    std::vector<uint8_t> m_inSet;       // Scratch: 1 = orphaned, 2 = re-attached
+
+    uint32_t m_spfRuns;
+    uint64_t m_nodesRecomputed;
+    uint32_t m_routeChanges;
+};
+
+} // namespace ns3
+
+#endif /* LINK_STATE_ROUTING_H */
@@ -0,0 +1,166 @@
+/*
+ * Filtered, sampled PCAP capture shared by the exercise scripts. Replaces
+ * EnablePcapAll (one file and one unbuffered write per packet per device) with a
+ * single capture file for every selected device, written in large blocks by a
+ * BackgroundWriter.
+ *
+ * A packet is recorded once per hop, when its transmission starts, with the
+ * device's PPP header (DLT_PPP). The selection is applied in this order:
+ *   filter    DSCP and/or flow (source, destination, protocol, destination port),
+ *             read straight from the packet bytes, no header objects
+ *   sample    keep 1 in N of the packets that passed the filter
+ *   snaplen   keep only the first bytes of each packet (headers only)
+ * A tracer that was never installed costs nothing: no trace is connected.
+ */
+
+#ifndef PACKET_TRACER_H
+#define PACKET_TRACER_H
+
+#include "background-writer.h"
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+class PacketTracer
+{
+public:
+    PacketTracer()
+    : m_sample(1), m_snaplen(65535), m_dscp(-1), m_flowSrc(0), m_flowDst(0), m_flowProtocol(0),
+      m_flowPort(0), m_flowFilter(false), m_matched(0), m_written(0)
+    {}
+
+    ~PacketTracer() { Close(); }
+
+    // Keep 1 in n of the packets that pass the filters
+    void SetSampling(uint32_t n)
+    {
+        NS_ABORT_MSG_IF(n == 0, "PacketTracer: sampling must be at least 1");
+        m_sample = n;
+    }
+
+    // Bytes kept per packet, PPP header included
+    void SetSnaplen(uint32_t snaplen)
+    {
+        NS_ABORT_MSG_IF(snaplen < PPP_HEADER, "PacketTracer: snaplen below the PPP header");
+        m_snaplen = snaplen;
+    }
+
+    // Only IPv4 packets with this DSCP; -1 accepts any
+    void SetDscpFilter(int dscp) { m_dscp = dscp; }
+
+    // Only IPv4 packets of this flow; the any address and 0 are wildcards
+    void SetFlowFilter(Ipv4Address src, Ipv4Address dst, uint8_t protocol, uint16_t port)
+    {
+        m_flowSrc = src.Get();
+        m_flowDst = dst.Get();
+        m_flowProtocol = protocol;
+        m_flowPort = port;
+        m_flowFilter = true;
+    }
+
+    void Open(const std::string& path)
+    {
+        m_writer.Open(path);
+        uint32_t global[6] = {0xa1b2c3d4, 2 | (4 << 16), 0, 0, m_snaplen, DLT_PPP};
+        m_writer.Write(global, sizeof(global));
+        m_buffer.resize(std::max(m_snaplen, FILTER_BYTES));
+    }
+
+    // Captures every packet the devices start transmitting
+    void Install(const NetDeviceContainer& devices)
+    {
+        NS_ABORT_MSG_IF(!m_writer.IsOpen(), "PacketTracer: Open before Install");
+        for (uint32_t i = 0; i < devices.GetN(); ++i)
+        {
+            devices.Get(i)->TraceConnectWithoutContext("PhyTxBegin", MakeCallback(&PacketTracer::Capture, this));
+        }
+    }
+
+    void Close() { m_writer.Close(); }
+
+    uint64_t GetMatched() const { return m_matched; }
+    uint64_t GetWritten() const { return m_written; }
+
+private:
+    void Capture(Ptr<const Packet> packet)
+    {
+        // Only the header bytes are copied until the packet is known to be kept
+        if (m_dscp >= 0 || m_flowFilter) {
+            uint32_t copied = packet->CopyData(m_buffer.data(), FILTER_BYTES);
+            if (!Match(m_buffer.data(), copied)) {
+                return;
+            }
+        }
+        if (m_matched++ % m_sample != 0) {
+            return;
+        }
+        uint32_t size = packet->GetSize();
+        uint32_t kept = packet->CopyData(m_buffer.data(), std::min(size, m_snaplen));
+        uint64_t ns = Simulator::Now().GetNanoSeconds();
+        uint32_t record[4] = {static_cast<uint32_t>(ns / 1000000000), static_cast<uint32_t>(ns % 1000000000 / 1000),
+                              kept, size};
+        m_writer.Write(record, sizeof(record));
+        m_writer.Write(m_buffer.data(), kept);
+        ++m_written;
+    }
+
+    // DSCP / flow match on the raw PPP + IPv4 (+ transport ports) bytes
+    bool Match(const uint8_t* p, uint32_t len) const
+    {
+        if (len < PPP_HEADER + 20 || p[0] != 0x00 || p[1] != 0x21) {
+            return false; // Not IPv4
+        }
+        const uint8_t* ip = p + PPP_HEADER;
+        if (m_dscp >= 0 && (ip[1] >> 2) != m_dscp) {
+            return false;
+        }
+        if (!m_flowFilter) {
+            return true;
+        }
+        uint32_t src = ReadU32(ip + 12), dst = ReadU32(ip + 16);
+        if ((m_flowSrc && src != m_flowSrc) || (m_flowDst && dst != m_flowDst) ||
+            (m_flowProtocol && ip[9] != m_flowProtocol)) {
+            return false;
+        }
+        if (m_flowPort) {
+            uint32_t l4 = PPP_HEADER + (ip[0] & 0x0f) * 4;
+            if (len < l4 + 4 || (p[l4 + 2] << 8 | p[l4 + 3]) != m_flowPort) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static uint32_t ReadU32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[0]) << 24 | p[1] << 16 | p[2] << 8 | p[3];
+    }
+
+    static constexpr uint32_t DLT_PPP = 9;
+    static constexpr uint32_t PPP_HEADER = 2;
+    static constexpr uint32_t FILTER_BYTES = 64;    // PPP + IPv4 with options + ports
+
+    uint32_t m_sample;
+    uint32_t m_snaplen;
+    int m_dscp;
+    uint32_t m_flowSrc;
+    uint32_t m_flowDst;
+    uint8_t m_flowProtocol;
+    uint16_t m_flowPort;
+    bool m_flowFilter;
+    uint64_t m_matched;
+    uint64_t m_written;
+    std::vector<uint8_t> m_buffer;      // Copy of the captured prefix, reused
+    BackgroundWriter m_writer;
+};
+
+} // namespace ns3
+
+#endif /* PACKET_TRACER_H */
@@ -0,0 +1,56 @@
+/*
+ * Combines per-partition results of a distributed run (ns-3 built with MPI).
+ * Every partition passes its own values and gets back their element-wise sum,
+ * minimum or maximum over all partitions, so each one can report the totals.
+ * Every partition must make the same calls in the same order with the same
+ * counts. Without MPI, or when it is not enabled, the run is one partition and
+ * the values are left as they are.
+ */
+
+#ifndef PARTITION_REDUCE_H
+#define PARTITION_REDUCE_H
+
+#include "ns3/core-module.h"
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#include <mpi.h>
+#endif
+
+#include <cstdint>
+
+namespace ns3 {
+
+enum PartitionOp
+{
+    PARTITION_SUM,
+    PARTITION_MIN,
+    PARTITION_MAX
+};
+
+#ifdef NS3_MPI
+
+inline void PartitionReduce(void* values, uint32_t n, MPI_Datatype type, PartitionOp op)
+{
+    if (n == 0 || !MpiInterface::IsEnabled()) {
+        return;
+    }
+    MPI_Op mpiOp = op == PARTITION_SUM ? MPI_SUM : op == PARTITION_MIN ? MPI_MIN : MPI_MAX;
+    int status = MPI_Allreduce(MPI_IN_PLACE, values, n, type, mpiOp, MpiInterface::GetCommunicator());
+    NS_ABORT_MSG_IF(status != MPI_SUCCESS, "PartitionReduce: MPI_Allreduce failed");
+}
+
+inline void PartitionReduce(uint64_t* values, uint32_t n, PartitionOp op) { PartitionReduce(values, n, MPI_UINT64_T, op); }
+inline void PartitionReduce(int64_t* values, uint32_t n, PartitionOp op) { PartitionReduce(values, n, MPI_INT64_T, op); }
+inline void PartitionReduce(double* values, uint32_t n, PartitionOp op) { PartitionReduce(values, n, MPI_DOUBLE, op); }
+
+#else
+
+inline void PartitionReduce(uint64_t*, uint32_t, PartitionOp) {}
+inline void PartitionReduce(int64_t*, uint32_t, PartitionOp) {}
+inline void PartitionReduce(double*, uint32_t, PartitionOp) {}
+
+#endif
+
+} // namespace ns3
+
+#endif /* PARTITION_REDUCE_H */
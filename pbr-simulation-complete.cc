@@ -2,6 +2,33 @@
  * Exercise 5: Policy-Based Routing Main Script (Self-Contained)
  * Topology: Studio (n0) -> Router (n1) -> Cloud (n2) via two parallel links (Primary/Secondary).
  * Implements: PBR routing logic directly in this file.
+ * Policies (DSCP, protocol, prefixes, port ranges) are compiled into a 64-entry
+ * DSCP lookup table plus a packed rule vector for O(1) DSCP-only classification.
+ * PbrRouting sits in the router's Ipv4ListRouting above static/global routing and
+ * policy-routes both transit (RouteInput) and locally originated (RouteOutput)
+ * traffic; unmatched packets fall through to the lower-priority protocols.
+ * The scenario's policies only match traffic headed for Cloud's subnets, and a
+ * transit packet is never policy-routed back out of its ingress interface.
+ * Run with --loadShare to spread both classes over the parallel links by a
+ * weighted, flow-sticky 5-tuple hash.
+ * Each policy carries a precomputed backup egress; interface down/up
+ * notifications flip it over in O(1) and are recorded for convergence studies
+ * (--failPrimaryAt / --restorePrimaryAt).
+ * Instead of per-packet log strings the router keeps counters: hits per policy,
+ * fallbacks to lower-priority routing, backup use and its queue discs'
+ * enqueue/dequeue/drop counts; --profile adds RouteOutput/RouteInput latency
+ * histograms. They are printed at the end and every --statsInterval seconds.
+ * The topology comes from PBR_TOPOLOGY below or a file given with --topology;
+ * PBR egress interfaces are resolved by link name.
+ * --studios=N adds studio nodes behind the Router sharing the flows;
+ * --scheduler picks the event queue, and --benchmark runs the scenario for every
+ * --benchSchedulers x --benchNodes (studios) x --benchFlows case, reporting
+ * events/s, wall time and peak RSS per case.
+ * --golden=<file> runs headless and gates the result on the file's tolerance
+ * bands (see regression-gate.h and regression.sh).
+ * --distributed (ns-3 built with MPI, e.g. mpirun -np 3) simulates the studios,
+ * the Router and the Cloud in their own partitions; each counter is taken where
+ * its node is simulated and summed over the partitions.
  */
 
 #include "ns3/core-module.h"
@@ -12,40 +39,177 @@
 #include "ns3/ipv4-routing-protocol.h"
 #include "ns3/ipv4-route.h"
 #include "ns3/log.h"
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
+
+#include "hot-path-stats.h"
+#include "partition-reduce.h"
+#include "regression-gate.h"
+#include "scheduler-benchmark.h"
+#include "udp-count-sink.h"
+#include "wan-topology.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("PbrSimulationComplete");
 
+// =================================================================
+// Policy Table Types
+// =================================================================
+
+// A single PBR rule as configured by the user. Wildcard fields match anything;
+// rules are evaluated in insertion order and the first match wins.
+struct PbrPolicy
+{
+    static const int16_t ANY_DSCP = -1;
+    static const uint32_t NO_GROUP = 0xffffffff;
+    static const uint32_t NO_EGRESS = 0xffffffff;
+
+    std::string name;                               // Label used in the routing table dump
+    int16_t dscp = ANY_DSCP;                        // 0..63, or ANY_DSCP
+    uint8_t protocol = 0;                           // IP protocol number, 0 = any
+    Ipv4Address srcPrefix = Ipv4Address::GetAny();
+    Ipv4Mask srcMask = Ipv4Mask::GetZero();
+    Ipv4Address dstPrefix = Ipv4Address::GetAny();
+    Ipv4Mask dstMask = Ipv4Mask::GetZero();
+    uint16_t srcPortMin = 0;
+    uint16_t srcPortMax = 65535;
+    uint16_t dstPortMin = 0;
+    uint16_t dstPortMax = 65535;
+    uint32_t egress = 0;                            // Id returned by PbrRouting::AddEgress()
+    uint32_t group = NO_GROUP;                      // Id from AddLoadShareGroup(); overrides egress
+    uint32_t backupEgress = NO_EGRESS;              // Used while the primary egress/group is down
+
+    // True if the rule only looks at the DSCP value (resolved by table lookup alone)
+    bool IsDscpOnly() const {
+        return protocol == 0 && srcMask == Ipv4Mask::GetZero() && dstMask == Ipv4Mask::GetZero()
+               && !HasPorts();
+    }
+    bool HasPorts() const {
+        return srcPortMin != 0 || srcPortMax != 65535 || dstPortMin != 0 || dstPortMax != 65535;
+    }
+};
+
+// Fields of a packet that the policy table can match on.
+// Ports are only known once the transport header is present on the packet.
+struct PbrFlowKey
+{
+    uint32_t src = 0;
+    uint32_t dst = 0;
+    uint16_t srcPort = 0;
+    uint16_t dstPort = 0;
+    uint8_t protocol = 0;
+    uint8_t dscp = 0;
+    bool hasPorts = false;
+};
+
+// Packed form of a non DSCP-only rule, laid out for a tight linear scan.
+// Prefixes are pre-masked so a match is a single AND + compare per address.
+struct PbrCompiledRule
+{
+    uint32_t srcAddr;
+    uint32_t srcMask;
+    uint32_t dstAddr;
+    uint32_t dstMask;
+    uint16_t srcPortMin;
+    uint16_t srcPortMax;
+    uint16_t dstPortMin;
+    uint16_t dstPortMax;
+    uint32_t policy;      // Index into PbrRouting::m_policies
+    uint8_t protocol;
+    bool needsPorts;
+};
+
+// One entry per DSCP value: the rules to scan for this DSCP (a slice of the
+// packed rule vector) and the DSCP-only policy that terminates the scan.
+struct PbrDscpSlot
+{
+    uint32_t first = 0;
+    uint32_t count = 0;
+    uint32_t policy = 0;
+};
+
+// One interface state change seen by PbrRouting
+struct PbrFailoverEvent
+{
+    Time time;
+    uint32_t interface;
+    bool up;
+    uint32_t policiesAffected;  // Policies whose primary path uses the interface
+};
+
+// Decision counters of one router, on their own cache lines
+struct alignas(CACHE_LINE) PbrNodeStats
+{
+    uint64_t routeOutput = 0;
+    uint64_t routeInput = 0;
+    uint64_t unmatched = 0;         // No policy matched, deferred to lower-priority routing
+    uint64_t noEgress = 0;          // Policy matched but neither path is usable, deferred too
+    uint64_t backupHits = 0;        // Routed over a policy's backup egress
+    uint64_t hairpins = 0;          // Transit policy egress was the ingress interface, deferred
+    std::vector<uint64_t> policyHits;
+    LatencyHistogram outputLatency; // Only filled while profiling
+    LatencyHistogram inputLatency;
+};
+
 // =================================================================
 // PbrRouting Class Definition (Self-Contained)
 // =================================================================
 class PbrRouting : public Ipv4RoutingProtocol
 {
 public:
-    PbrRouting(Ipv4Address videoNextHop, Ipv4Address dataNextHop,
-               uint32_t videoIfIndex, uint32_t dataIfIndex)
-    : m_videoNextHop(videoNextHop), 
-      m_dataNextHop(dataNextHop), 
-      m_videoIfIndex(videoIfIndex), 
-      m_dataIfIndex(dataIfIndex)
-    {}
+    static const uint32_t NO_POLICY = 0xffffffff;
+    static const uint32_t DSCP_SLOTS = 64;
+    static const uint32_t LOAD_SHARE_BUCKETS = 256;   // Power of two; hash -> bucket by mask
+
+    PbrRouting() {}
 
     virtual ~PbrRouting() {}
 
     static TypeId GetTypeId(void) {
         static TypeId tid = TypeId("ns3::PbrRouting")
             .SetParent<Ipv4RoutingProtocol>()
-            .SetGroupName("Internet");
+            .SetGroupName("Internet")
+            .AddTraceSource("Failover", "An egress interface went down or came back up",
+                            MakeTraceSourceAccessor(&PbrRouting::m_failoverTrace),
+                            "ns3::PbrRouting::FailoverTracedCallback");
         return tid;
     }
 
+    typedef void (*FailoverTracedCallback)(uint32_t interface, bool up);
+
+    // Policy configuration
+    uint32_t AddEgress(Ipv4Address nextHop, uint32_t ifIndex);
+    uint32_t AddLoadShareGroup(const std::vector<uint32_t>& egresses, const std::vector<uint32_t>& weights);
+    uint32_t AddPolicy(const PbrPolicy& policy);
+    void SetHashSeed(uint32_t seed) { m_hashSeed = seed; }
+    void CompilePolicies();
+
+    // Returns the index of the first matching policy, or NO_POLICY
+    uint32_t Classify(const PbrFlowKey& key) const;
+
+    // Failover bookkeeping
+    const std::vector<PbrFailoverEvent>& GetFailoverEvents() const { return m_failoverEvents; }
+    uint32_t GetFailoverCount() const { return m_failovers; }
+    uint32_t GetRestoreCount() const { return m_restores; }
+
+    // Hot-path counters; profiling adds the per-call latency histograms
+    void SetProfiling(bool enable) { m_profiling = enable; }
+    const PbrNodeStats& GetStats() const { return m_stats; }
+    void PrintStats(std::ostream& os) const;
+
     // Required overrides
-    virtual void SetIpv4(Ptr<Ipv4> ipv4) override { m_ipv4 = ipv4; }
-    virtual void NotifyInterfaceUp(uint32_t interface) override {}
-    virtual void NotifyInterfaceDown(uint32_t interface) override {}
-    virtual void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override {}
-    virtual void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override {}
+    virtual void SetIpv4(Ptr<Ipv4> ipv4) override;
+    virtual void NotifyInterfaceUp(uint32_t interface) override { InvalidateRoutes(interface); SetLinkState(interface, true); }
+    virtual void NotifyInterfaceDown(uint32_t interface) override { InvalidateRoutes(interface); SetLinkState(interface, false); }
+    virtual void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override { InvalidateRoutes(interface); }
+    virtual void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override { InvalidateRoutes(interface); }
     
     // Q2: Core PBR logic - using 'sockerr' instead of 'errno'
     virtual Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p, const Ipv4Header& header, 
@@ -56,121 +220,724 @@ public:
                             UnicastForwardCallback ucb, MulticastForwardCallback mcb, 
                             LocalDeliverCallback lcb, ErrorCallback ecb) override;
                             
-    virtual void PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const override {
-        *stream->GetStream() << "PbrRouting Table: Policy-Based Routing Active (DSCP EF -> Primary, DSCP BE -> Secondary)" << std::endl;
-    }
+    virtual void PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const override;
 
 private:
+    struct PbrEgress
+    {
+        Ipv4Address nextHop;
+        uint32_t ifIndex;
+        Ptr<Ipv4Route> route;   // Shared, never modified once built; null if unusable
+        bool routeValid;        // False until (re)built after an interface/address change
+        bool linkUp;            // Interface state, flipped by NotifyInterfaceUp/Down
+    };
+
+    // Flows hash onto a fixed bucket table filled in proportion to the member
+    // weights, so a flow keeps its egress for as long as the table is unchanged.
+    struct PbrLoadShareGroup
+    {
+        std::vector<uint32_t> egresses;
+        std::vector<uint32_t> weights;
+        uint32_t buckets[LOAD_SHARE_BUCKETS];
+        uint32_t liveBuckets[LOAD_SHARE_BUCKETS];  // buckets with down members remapped
+    };
+
+    uint32_t SelectEgress(uint32_t policy, const PbrFlowKey& key) const;
+    static uint32_t FlowHash(const PbrFlowKey& key, uint32_t seed);
+    Ptr<Ipv4Route> GetEgressRoute(uint32_t egressId);
+    void InvalidateRoutes();
+    void InvalidateRoutes(uint32_t interface);
+    void SetLinkState(uint32_t interface, bool up);
+    void RebuildLiveBuckets(PbrLoadShareGroup& group);
+    bool PolicyUsesInterface(const PbrPolicy& policy, uint32_t interface) const;
+    Ptr<Ipv4Route> Decide(const PbrFlowKey& key);
+
+    static PbrFlowKey MakeFlowKey(const Ipv4Header& header);
+    static PbrFlowKey MakeFlowKey(const Ipv4Header& header, Ptr<const Packet> p);
+    static bool Matches(const PbrCompiledRule& rule, const PbrFlowKey& key);
+
     Ptr<Ipv4> m_ipv4;
-    Ipv4Address m_videoNextHop; 
-    Ipv4Address m_dataNextHop;  
-    uint32_t m_videoIfIndex;    
-    uint32_t m_dataIfIndex;     
+    std::vector<PbrEgress> m_egresses;
+    std::vector<std::vector<uint32_t> > m_ifEgresses;  // Interface index -> egress ids on it
+    std::vector<PbrLoadShareGroup> m_groups;
+    uint32_t m_hashSeed = 0;
+    std::vector<PbrPolicy> m_policies;           // Configured rules, in priority order
+    std::vector<PbrCompiledRule> m_compiled;     // Packed rules, grouped per DSCP slot
+    PbrDscpSlot m_dscpTable[DSCP_SLOTS];         // DSCP -> slice of m_compiled + terminal policy
+    bool m_dirty = true;
+
+    std::vector<PbrFailoverEvent> m_failoverEvents;
+    uint32_t m_failovers = 0;
+    uint32_t m_restores = 0;
+    TracedCallback<uint32_t, bool> m_failoverTrace;
+
+    PbrNodeStats m_stats;
+    bool m_profiling = false;
 };
 
 // =================================================================
 // PbrRouting Implementation
 // =================================================================
 
-Ptr<Ipv4Route> PbrRouting::RouteOutput(Ptr<Packet> p, const Ipv4Header& header, 
-                                       Ptr<NetDevice> oif, Socket::SocketErrno& sockerr)
+uint32_t PbrRouting::AddEgress(Ipv4Address nextHop, uint32_t ifIndex)
 {
-    const uint8_t DSCP_VIDEO_EF = 0x2e; // Expedited Forwarding (VoIP/Video)
-    const uint8_t DSCP_DATA_BE = 0x00;  // Best Effort (Data/FTP)
+    PbrEgress egress;
+    egress.nextHop = nextHop;
+    egress.ifIndex = ifIndex;
+    egress.routeValid = false;
+    egress.linkUp = m_ipv4 ? m_ipv4->IsUp(ifIndex) : true;
+    m_egresses.push_back(egress);
 
-    // 1. Classification based on DSCP/TOS field
-    uint8_t dscp = header.GetDscp(); 
+    if (m_ifEgresses.size() <= ifIndex) {
+        m_ifEgresses.resize(ifIndex + 1);
+    }
+    m_ifEgresses[ifIndex].push_back(m_egresses.size() - 1);
+    return m_egresses.size() - 1;
+}
 
-    if (dscp == DSCP_VIDEO_EF) {
-        // Policy: Video traffic (EF) uses the Primary path (Net 2)
-        NS_LOG_INFO("PBR: Video traffic (EF), routing via Primary (Net 2)");
-        Ptr<Ipv4Route> route = Create<Ipv4Route>();
-        route->SetDestination(header.GetDestination());
-        route->SetSource(m_ipv4->GetAddress(m_videoIfIndex, 0).GetLocal());
-        route->SetGateway(m_videoNextHop); 
-        route->SetOutputDevice(m_ipv4->GetNetDevice(m_videoIfIndex));
-        return route;
+void PbrRouting::SetIpv4(Ptr<Ipv4> ipv4)
+{
+    m_ipv4 = ipv4;
+    InvalidateRoutes();
+    for (uint32_t i = 0; i < m_egresses.size(); ++i)
+    {
+        m_egresses[i].linkUp = m_ipv4->IsUp(m_egresses[i].ifIndex);
     }
-    else if (dscp == DSCP_DATA_BE) {
-        // Policy: Data traffic (BE) uses the Secondary path (Net 3)
-        NS_LOG_INFO("PBR: Data traffic (BE), routing via Secondary (Net 3)");
-        Ptr<Ipv4Route> route = Create<Ipv4Route>();
-        route->SetDestination(header.GetDestination());
-        route->SetSource(m_ipv4->GetAddress(m_dataIfIndex, 0).GetLocal());
-        route->SetGateway(m_dataNextHop); 
-        route->SetOutputDevice(m_ipv4->GetNetDevice(m_dataIfIndex));
+    for (uint32_t g = 0; g < m_groups.size(); ++g)
+    {
+        RebuildLiveBuckets(m_groups[g]);
+    }
+}
+
+// Fills the bucket table with smooth weighted round-robin so members are
+// interleaved rather than laid out in contiguous runs.
+uint32_t PbrRouting::AddLoadShareGroup(const std::vector<uint32_t>& egresses, const std::vector<uint32_t>& weights)
+{
+    NS_ABORT_MSG_IF(egresses.empty() || egresses.size() != weights.size(), "PBR: load-share group needs one weight per egress");
+
+    int64_t total = 0;
+    for (uint32_t i = 0; i < egresses.size(); ++i)
+    {
+        NS_ABORT_MSG_IF(egresses[i] >= m_egresses.size(), "PBR: load-share group uses unknown egress " << egresses[i]);
+        total += weights[i];
+    }
+    NS_ABORT_MSG_IF(total == 0, "PBR: load-share group has zero total weight");
+
+    PbrLoadShareGroup group;
+    group.egresses = egresses;
+    group.weights = weights;
+    std::vector<int64_t> current(egresses.size(), 0);
+    for (uint32_t b = 0; b < LOAD_SHARE_BUCKETS; ++b)
+    {
+        uint32_t best = 0;
+        for (uint32_t i = 0; i < egresses.size(); ++i)
+        {
+            current[i] += weights[i];
+            if (current[i] > current[best]) {
+                best = i;
+            }
+        }
+        current[best] -= total;
+        group.buckets[b] = egresses[best];
+    }
+    RebuildLiveBuckets(group);
+    m_groups.push_back(group);
+    return m_groups.size() - 1;
+}
+
+uint32_t PbrRouting::AddPolicy(const PbrPolicy& policy)
+{
+    if (policy.group == PbrPolicy::NO_GROUP) {
+        NS_ABORT_MSG_IF(policy.egress >= m_egresses.size(), "PBR: policy '" << policy.name << "' uses unknown egress " << policy.egress);
+    } else {
+        NS_ABORT_MSG_IF(policy.group >= m_groups.size(), "PBR: policy '" << policy.name << "' uses unknown group " << policy.group);
+    }
+    NS_ABORT_MSG_IF(policy.backupEgress != PbrPolicy::NO_EGRESS && policy.backupEgress >= m_egresses.size(),
+                    "PBR: policy '" << policy.name << "' uses unknown backup egress " << policy.backupEgress);
+    NS_ABORT_MSG_IF(policy.dscp >= static_cast<int16_t>(DSCP_SLOTS), "PBR: DSCP out of range in policy '" << policy.name << "'");
+    m_policies.push_back(policy);
+    m_stats.policyHits.push_back(0);
+    m_dirty = true;
+    return m_policies.size() - 1;
+}
+
+// Flattens the rule list into the per-DSCP lookup table. For every DSCP value the
+// applicable rules are copied (in priority order) into a contiguous slice of
+// m_compiled, stopping at the first DSCP-only rule, which becomes the slot's
+// terminal policy. Pure DSCP policies therefore classify with one array index.
+void PbrRouting::CompilePolicies()
+{
+    m_compiled.clear();
+    for (uint32_t dscp = 0; dscp < DSCP_SLOTS; ++dscp)
+    {
+        PbrDscpSlot& slot = m_dscpTable[dscp];
+        slot.first = m_compiled.size();
+        slot.policy = NO_POLICY;
+
+        for (uint32_t i = 0; i < m_policies.size(); ++i)
+        {
+            const PbrPolicy& policy = m_policies[i];
+            if (policy.dscp != PbrPolicy::ANY_DSCP && static_cast<uint32_t>(policy.dscp) != dscp) {
+                continue;
+            }
+            if (policy.IsDscpOnly()) {
+                slot.policy = i;
+                break;
+            }
+
+            PbrCompiledRule rule;
+            rule.srcMask = policy.srcMask.Get();
+            rule.srcAddr = policy.srcPrefix.Get() & rule.srcMask;
+            rule.dstMask = policy.dstMask.Get();
+            rule.dstAddr = policy.dstPrefix.Get() & rule.dstMask;
+            rule.srcPortMin = policy.srcPortMin;
+            rule.srcPortMax = policy.srcPortMax;
+            rule.dstPortMin = policy.dstPortMin;
+            rule.dstPortMax = policy.dstPortMax;
+            rule.policy = i;
+            rule.protocol = policy.protocol;
+            rule.needsPorts = policy.HasPorts();
+            m_compiled.push_back(rule);
+        }
+        slot.count = m_compiled.size() - slot.first;
+    }
+    m_dirty = false;
+    NS_LOG_INFO("PBR: compiled " << m_policies.size() << " policies into " << m_compiled.size() << " packed rules");
+}
+
+// 5-tuple hash (splitmix64 finalizer rounds). The DSCP is deliberately left out
+// so a flow stays on one path even if its marking changes. Locally originated
+// packets have no ports yet and hash on addresses and protocol only.
+uint32_t PbrRouting::FlowHash(const PbrFlowKey& key, uint32_t seed)
+{
+    uint64_t h = seed ^ ((static_cast<uint64_t>(key.src) << 32) | key.dst);
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h ^= (static_cast<uint64_t>(key.srcPort) << 24) ^ (static_cast<uint64_t>(key.dstPort) << 8) ^ key.protocol;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return static_cast<uint32_t>(h);
+}
+
+// Returns the egress for a matched policy, or NO_EGRESS if neither the primary
+// path nor the backup is up. Link state is tracked per egress, so the switch to
+// the backup costs one flag test per packet and nothing is recomputed here.
+uint32_t PbrRouting::SelectEgress(uint32_t policy, const PbrFlowKey& key) const
+{
+    const PbrPolicy& rule = m_policies[policy];
+    uint32_t egress;
+    if (rule.group == PbrPolicy::NO_GROUP) {
+        egress = m_egresses[rule.egress].linkUp ? rule.egress : PbrPolicy::NO_EGRESS;
+    } else {
+        const PbrLoadShareGroup& group = m_groups[rule.group];
+        egress = group.liveBuckets[FlowHash(key, m_hashSeed) & (LOAD_SHARE_BUCKETS - 1)];
+    }
+
+    if (egress == PbrPolicy::NO_EGRESS && rule.backupEgress != PbrPolicy::NO_EGRESS
+        && m_egresses[rule.backupEgress].linkUp) {
+        egress = rule.backupEgress;
+    }
+    return egress;
+}
+
+// Buckets of live members keep their egress so their flows are not moved;
+// only the buckets of down members are dealt out round-robin to the live ones.
+void PbrRouting::RebuildLiveBuckets(PbrLoadShareGroup& group)
+{
+    std::vector<uint32_t> live;
+    for (uint32_t i = 0; i < group.egresses.size(); ++i)
+    {
+        if (m_egresses[group.egresses[i]].linkUp) {
+            live.push_back(group.egresses[i]);
+        }
+    }
+
+    uint32_t next = 0;
+    for (uint32_t b = 0; b < LOAD_SHARE_BUCKETS; ++b)
+    {
+        if (m_egresses[group.buckets[b]].linkUp) {
+            group.liveBuckets[b] = group.buckets[b];
+        } else if (live.empty()) {
+            group.liveBuckets[b] = PbrPolicy::NO_EGRESS;
+        } else {
+            group.liveBuckets[b] = live[next++ % live.size()];
+        }
+    }
+}
+
+bool PbrRouting::PolicyUsesInterface(const PbrPolicy& policy, uint32_t interface) const
+{
+    if (policy.group == PbrPolicy::NO_GROUP) {
+        return m_egresses[policy.egress].ifIndex == interface;
+    }
+    const PbrLoadShareGroup& group = m_groups[policy.group];
+    for (uint32_t i = 0; i < group.egresses.size(); ++i)
+    {
+        if (m_egresses[group.egresses[i]].ifIndex == interface) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Called from NotifyInterfaceUp/Down. Flips the egresses on the interface and
+// re-deals the bucket tables of load-share groups; single-egress policies need
+// no work since SelectEgress checks the flag directly.
+void PbrRouting::SetLinkState(uint32_t interface, bool up)
+{
+    if (interface >= m_ifEgresses.size()) {
+        return;
+    }
+
+    bool changed = false;
+    const std::vector<uint32_t>& egresses = m_ifEgresses[interface];
+    for (uint32_t i = 0; i < egresses.size(); ++i)
+    {
+        PbrEgress& egress = m_egresses[egresses[i]];
+        if (egress.linkUp != up) {
+            egress.linkUp = up;
+            changed = true;
+        }
+    }
+    if (!changed) {
+        return;
+    }
+
+    for (uint32_t g = 0; g < m_groups.size(); ++g)
+    {
+        RebuildLiveBuckets(m_groups[g]);
+    }
+
+    PbrFailoverEvent event;
+    event.time = Simulator::Now();
+    event.interface = interface;
+    event.up = up;
+    event.policiesAffected = 0;
+    for (uint32_t i = 0; i < m_policies.size(); ++i)
+    {
+        if (PolicyUsesInterface(m_policies[i], interface)) {
+            ++event.policiesAffected;
+        }
+    }
+    m_failoverEvents.push_back(event);
+    if (up) {
+        ++m_restores;
+    } else {
+        ++m_failovers;
+    }
+
+    NS_LOG_INFO("PBR: interface " << interface << (up ? " UP, restoring " : " DOWN, failing over ")
+                << event.policiesAffected << " policies at " << event.time.GetSeconds() << "s");
+    m_failoverTrace(interface, up);
+}
+
+// Returns the cached route for an egress, building it on first use after an
+// invalidation. The route only depends on the egress interface and next hop, so
+// one object is shared by every packet of every policy that uses the egress.
+Ptr<Ipv4Route> PbrRouting::GetEgressRoute(uint32_t egressId)
+{
+    PbrEgress& egress = m_egresses[egressId];
+    if (egress.routeValid) {
+        return egress.route;
+    }
+
+    egress.routeValid = true;
+    egress.route = 0;
+    if (!m_ipv4->IsUp(egress.ifIndex) || m_ipv4->GetNAddresses(egress.ifIndex) == 0) {
+        NS_LOG_LOGIC("PBR: egress " << egressId << " (if " << egress.ifIndex << ") unusable, policies fall back");
+        return egress.route;
+    }
+
+    Ptr<Ipv4Route> route = Create<Ipv4Route>();
+    route->SetDestination(Ipv4Address::GetAny()); // Informational only; forwarding uses the gateway
+    route->SetSource(m_ipv4->GetAddress(egress.ifIndex, 0).GetLocal());
+    route->SetGateway(egress.nextHop);
+    route->SetOutputDevice(m_ipv4->GetNetDevice(egress.ifIndex));
+    egress.route = route;
+    return egress.route;
+}
+
+void PbrRouting::InvalidateRoutes()
+{
+    for (uint32_t i = 0; i < m_egresses.size(); ++i)
+    {
+        m_egresses[i].routeValid = false;
+        m_egresses[i].route = 0;
+    }
+}
+
+void PbrRouting::InvalidateRoutes(uint32_t interface)
+{
+    if (interface >= m_ifEgresses.size()) {
+        return;
+    }
+    const std::vector<uint32_t>& egresses = m_ifEgresses[interface];
+    for (uint32_t i = 0; i < egresses.size(); ++i)
+    {
+        m_egresses[egresses[i]].routeValid = false;
+        m_egresses[egresses[i]].route = 0;
+    }
+}
+
+bool PbrRouting::Matches(const PbrCompiledRule& rule, const PbrFlowKey& key)
+{
+    if ((key.src & rule.srcMask) != rule.srcAddr || (key.dst & rule.dstMask) != rule.dstAddr) {
+        return false;
+    }
+    if (rule.protocol != 0 && rule.protocol != key.protocol) {
+        return false;
+    }
+    if (rule.needsPorts) {
+        // Port-qualified rules cannot match a packet whose ports are unknown
+        return key.hasPorts
+               && key.srcPort >= rule.srcPortMin && key.srcPort <= rule.srcPortMax
+               && key.dstPort >= rule.dstPortMin && key.dstPort <= rule.dstPortMax;
+    }
+    return true;
+}
+
+uint32_t PbrRouting::Classify(const PbrFlowKey& key) const
+{
+    const PbrDscpSlot& slot = m_dscpTable[key.dscp & (DSCP_SLOTS - 1)];
+    const PbrCompiledRule* rule = m_compiled.data() + slot.first;
+    const PbrCompiledRule* end = rule + slot.count;
+    for (; rule != end; ++rule)
+    {
+        if (Matches(*rule, key)) {
+            return rule->policy;
+        }
+    }
+    return slot.policy;
+}
+
+// Locally originated packets reach RouteOutput before the transport header is
+// added, so only the IP header fields are available here.
+PbrFlowKey PbrRouting::MakeFlowKey(const Ipv4Header& header)
+{
+    PbrFlowKey key;
+    key.src = header.GetSource().Get();
+    key.dst = header.GetDestination().Get();
+    key.protocol = header.GetProtocol();
+    key.dscp = static_cast<uint8_t>(header.GetDscp());
+    return key;
+}
+
+// Forwarded packets still carry their transport header. TCP and UDP both start
+// with the 16-bit source and destination ports, so the first 4 bytes are copied
+// out directly instead of deserializing a full header. Non-initial fragments
+// have no transport header and are classified without ports.
+PbrFlowKey PbrRouting::MakeFlowKey(const Ipv4Header& header, Ptr<const Packet> p)
+{
+    PbrFlowKey key = MakeFlowKey(header);
+    if ((key.protocol == UdpL4Protocol::PROT_NUMBER || key.protocol == TcpL4Protocol::PROT_NUMBER)
+        && header.GetFragmentOffset() == 0 && p->GetSize() >= 4)
+    {
+        uint8_t ports[4];
+        p->CopyData(ports, 4);
+        key.srcPort = static_cast<uint16_t>((ports[0] << 8) | ports[1]);
+        key.dstPort = static_cast<uint16_t>((ports[2] << 8) | ports[3]);
+        key.hasPorts = true;
+    }
+    return key;
+}
+
+// Shared policy decision: the route of the matched policy's usable egress, or
+// null to defer to the lower-priority protocols. Only counters are touched.
+Ptr<Ipv4Route> PbrRouting::Decide(const PbrFlowKey& key)
+{
+    uint32_t policy = Classify(key);
+    if (policy == NO_POLICY) {
+        ++m_stats.unmatched;
+        return 0;
+    }
+
+    uint32_t egress = SelectEgress(policy, key);
+    Ptr<Ipv4Route> route = (egress != PbrPolicy::NO_EGRESS) ? GetEgressRoute(egress) : 0;
+    if (!route) {
+        ++m_stats.noEgress;
+        return 0;
+    }
+    ++m_stats.policyHits[policy];
+    m_stats.backupHits += (egress == m_policies[policy].backupEgress);
+    return route;
+}
+
+Ptr<Ipv4Route> PbrRouting::RouteOutput(Ptr<Packet> p, const Ipv4Header& header, 
+                                       Ptr<NetDevice> oif, Socket::SocketErrno& sockerr)
+{
+    LatencyTimer timer(m_profiling ? &m_stats.outputLatency : 0);
+    ++m_stats.routeOutput;
+    if (m_dirty) {
+        CompilePolicies();
+    }
+
+    // 1. Classification through the compiled policy table
+    Ptr<Ipv4Route> route = Decide(MakeFlowKey(header));
+    if (route) {
+        sockerr = Socket::ERROR_NOTERROR;
         return route;
     }
     
-    // Fallback: Use the default routing logic
-    NS_LOG_INFO("PBR: No match, deferring to underlying routing protocol.");
-    // FIX: Use GetRoutingProtocol() instead of GetRoutingServices() for NS-3.35 compatibility
-    return m_ipv4->GetRoutingProtocol()->RouteOutput(p, header, oif, sockerr); 
+    // Fallback: Returning no route lets Ipv4ListRouting try the next protocol
+    // (static, then global routing). Calling m_ipv4->GetRoutingProtocol() here
+    // would re-enter the list and recurse back into this object.
+    sockerr = Socket::ERROR_NOROUTETOHOST;
+    return 0;
 }
 
+// Transit path. Ipv4ListRouting has already handled local delivery and checked
+// that the ingress interface forwards before consulting this protocol, so only
+// the policy decision remains: forward directly on a match, otherwise return
+// false so the lower-priority protocols get the packet. A policy never sends a
+// packet back out of the interface it came in on; that would bounce it between
+// the router and its neighbour until the TTL runs out.
 bool PbrRouting::RouteInput(Ptr<const Packet> p, const Ipv4Header& header, Ptr<const NetDevice> idev, 
                            UnicastForwardCallback ucb, MulticastForwardCallback mcb, 
                            LocalDeliverCallback lcb, ErrorCallback ecb)
 {
-    // Defer input routing decisions to the underlying global routing system
-    // FIX: Use GetRoutingProtocol() instead of GetRoutingServices() for NS-3.35 compatibility
-    return m_ipv4->GetRoutingProtocol()->RouteInput(p, header, idev, ucb, mcb, lcb, ecb);
+    LatencyTimer timer(m_profiling ? &m_stats.inputLatency : 0);
+    ++m_stats.routeInput;
+    Ipv4Address dst = header.GetDestination();
+    if (dst.IsMulticast() || dst.IsBroadcast()) {
+        return false;
+    }
+
+    if (m_dirty) {
+        CompilePolicies();
+    }
+
+    Ptr<Ipv4Route> route = Decide(MakeFlowKey(header, p));
+    if (!route) {
+        return false;
+    }
+    if (PeekPointer(route->GetOutputDevice()) == PeekPointer(idev)) {
+        ++m_stats.hairpins;
+        return false;
+    }
+    ucb(route, p, header);
+    return true;
+}
+
+void PbrRouting::PrintStats(std::ostream& os) const
+{
+    os << "  RouteOutput " << m_stats.routeOutput << ", RouteInput " << m_stats.routeInput
+       << ", unmatched " << m_stats.unmatched << ", no usable egress " << m_stats.noEgress
+       << ", via backup " << m_stats.backupHits << ", hairpins deferred " << m_stats.hairpins << "\n";
+    for (uint32_t i = 0; i < m_policies.size(); ++i)
+    {
+        os << "  policy '" << m_policies[i].name << "': " << m_stats.policyHits[i] << " hits\n";
+    }
+    if (m_profiling) {
+        os << "  RouteOutput latency: ";
+        m_stats.outputLatency.Print(os);
+        os << "\n  RouteInput latency: ";
+        m_stats.inputLatency.Print(os);
+        os << "\n";
+    }
+}
+
+void PbrRouting::PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+    std::ostream* os = stream->GetStream();
+    *os << "PbrRouting Table: " << m_policies.size() << " policies (first match wins)" << std::endl;
+    for (uint32_t i = 0; i < m_policies.size(); ++i)
+    {
+        const PbrPolicy& policy = m_policies[i];
+        *os << "  [" << i << "] " << policy.name << " dscp=";
+        if (policy.dscp == PbrPolicy::ANY_DSCP) {
+            *os << "any";
+        } else {
+            *os << "0x" << std::hex << policy.dscp << std::dec;
+        }
+        *os << " proto=" << static_cast<uint32_t>(policy.protocol)
+            << " src=" << policy.srcPrefix << "/" << policy.srcMask.GetPrefixLength()
+            << " dst=" << policy.dstPrefix << "/" << policy.dstMask.GetPrefixLength()
+            << " sport=" << policy.srcPortMin << "-" << policy.srcPortMax
+            << " dport=" << policy.dstPortMin << "-" << policy.dstPortMax << " ->";
+        if (policy.group == PbrPolicy::NO_GROUP) {
+            const PbrEgress& egress = m_egresses[policy.egress];
+            *os << " " << egress.nextHop << " if " << egress.ifIndex;
+        } else {
+            const PbrLoadShareGroup& group = m_groups[policy.group];
+            for (uint32_t j = 0; j < group.egresses.size(); ++j)
+            {
+                const PbrEgress& egress = m_egresses[group.egresses[j]];
+                *os << " " << egress.nextHop << " if " << egress.ifIndex << " w=" << group.weights[j];
+            }
+        }
+        if (policy.backupEgress != PbrPolicy::NO_EGRESS) {
+            const PbrEgress& backup = m_egresses[policy.backupEgress];
+            *os << " (backup " << backup.nextHop << " if " << backup.ifIndex << ")";
+        }
+        *os << std::endl;
+    }
 }
 
 // =================================================================
 // Main Simulation Script
 // =================================================================
 
-int main(int argc, char *argv[])
+// Scenario parameters; the defaults reproduce the original exercise
+struct PbrConfig
 {
-    // Enable Logs for PBR decisions
-    LogComponentEnable("PbrRouting", LOG_LEVEL_INFO);
-    LogComponentEnable("OnOffApplication", LOG_LEVEL_INFO);
+    bool loadShare = false;             // Hash both classes over both links
+    uint32_t primaryWeight = 1;
+    uint32_t secondaryWeight = 1;
+    uint32_t flowsPerClass = 1;
+    uint32_t studios = 1;               // Studio nodes; flows are dealt round-robin over them
+    double failPrimaryAt = 0.0;         // 0 = never
+    double restorePrimaryAt = 0.0;      // 0 = never
+    std::string topologyFile;
+    bool profile = false;
+    double statsInterval = 0.0;         // 0 = counters only at the end
+    bool verbose = true;                // Final summary and counters
+    uint32_t systems = 1;               // Partitions of a distributed run
+    uint32_t systemId = 0;              // Partition simulated by this process
+};
 
+// What the regression gate checks
+struct PbrRunResult
+{
+    uint64_t primaryBytes = 0;          // Sent by the Router on each parallel link
+    uint64_t secondaryBytes = 0;
+    uint64_t cloudRxBytes = 0;
+    uint32_t failovers = 0;
+};
+
+// Default topology: Studio -> Router -> Cloud, with two parallel Router -> Cloud links;
+// every node is its own site
+const std::string PBR_TOPOLOGY =
+    "defaults rate=100Mbps delay=2ms\n"
+    "node studio site=0\n"
+    "node router site=1\n"
+    "node cloud site=2\n"
+    "link access    studio router subnet=10.0.1.0/24\n"
+    "link primary   router cloud  subnet=10.0.2.0/24   # Video path\n"
+    "link secondary router cloud  subnet=10.0.3.0/24   # Data path\n";
+
+// PBR_TOPOLOGY plus the extra studios, each on its own access link to the Router
+std::string PbrTopology(const PbrConfig& cfg)
+{
+    std::ostringstream topology;
+    topology << PBR_TOPOLOGY << "pool 10.64.0.0/10 30\n";
+    for (uint32_t i = 2; i <= cfg.studios; ++i)
+    {
+        topology << "node studio" << i << " site=" << i + 1 << "\nlink access" << i << " studio" << i << " router\n";
+    }
+    return topology.str();
+}
+
+// Failure injection: brings a router interface down or back up
+void SetRouterInterface(Ptr<Ipv4> ipv4, uint32_t interface, bool up)
+{
+    if (up) {
+        ipv4->SetUp(interface);
+    } else {
+        ipv4->SetDown(interface);
+    }
+}
+
+static void CountTxBytes(uint64_t* bytes, Ptr<const Packet> packet)
+{
+    *bytes += packet->GetSize();
+}
+
+// Hot-path counters of the router; reschedules itself for periodic dumps
+void PrintRouterStats(Ptr<PbrRouting> pbr, const NodeQueueStats* queues, double interval)
+{
+    std::cout << "=== Router counters at " << Simulator::Now().GetSeconds() << "s ===\n";
+    pbr->PrintStats(std::cout);
+    queues->Print(std::cout);
+    if (interval > 0.0) {
+        Simulator::Schedule(Seconds(interval), &PrintRouterStats, pbr, queues, interval);
+    }
+}
+
+PbrRunResult RunPbrScenario(const PbrConfig& cfg)
+{
+    PbrRunResult result;
     // Topology: Studio (n0) -> Router (n1) -> Cloud (n2)
-    NodeContainer nodes;
-    nodes.Create(3);
-    Ptr<Node> studio = nodes.Get(0);
-    Ptr<Node> router = nodes.Get(1);
-    Ptr<Node> cloud = nodes.Get(2);
-
-    PointToPointHelper p2p;
-    p2p.SetDeviceAttribute("DataRate", StringValue("100Mbps"));
-    p2p.SetChannelAttribute("Delay", StringValue("2ms"));
-
-    // Link 1: Studio -> Router (10.0.1.0/24)
-    NetDeviceContainer d0 = p2p.Install(studio, router);
-    // Link 2: Router -> Cloud (Primary/Video) (10.0.2.0/24)
-    NetDeviceContainer d1 = p2p.Install(router, cloud);
-    // Link 3: Router -> Cloud (Secondary/Data) (10.0.3.0/24)
-    NetDeviceContainer d2 = p2p.Install(router, cloud);
-
-    // Install Stack
-    InternetStackHelper internet;
-    internet.Install(nodes);
-
-    // Assign IPs
-    Ipv4AddressHelper ipv4;
-    ipv4.SetBase("10.0.1.0", "255.255.255.0"); ipv4.Assign(d0); 
-    ipv4.SetBase("10.0.2.0", "255.255.255.0"); Ipv4InterfaceContainer i1 = ipv4.Assign(d1); // Primary Link
-    ipv4.SetBase("10.0.3.0", "255.255.255.0"); Ipv4InterfaceContainer i2 = ipv4.Assign(d2); // Secondary Link
+    WanTopology topo;
+    topo.SetPartitioning(cfg.systems, cfg.systemId);
+    if (cfg.topologyFile.empty()) {
+        topo.LoadString(PbrTopology(cfg));
+    } else {
+        NS_ABORT_MSG_IF(cfg.studios > 1, "--studios only extends the built-in topology");
+        topo.LoadFile(cfg.topologyFile);
+    }
+    NodeContainer studios;
+    studios.Add(topo.GetNode("studio"));
+    for (uint32_t i = 2; i <= cfg.studios; ++i)
+    {
+        studios.Add(topo.GetNode("studio" + std::to_string(i)));
+    }
+    Ptr<Node> router = topo.GetNode("router");
+    Ptr<Node> cloud = topo.GetNode("cloud");
 
     // --- Install PBR on Router (n1) ---
-    Ipv4Address videoNextHop = i1.GetAddress(1); // 10.0.2.2 (Cloud IP on Primary)
-    Ipv4Address dataNextHop = i2.GetAddress(1);  // 10.0.3.2 (Cloud IP on Secondary)
-    
-    // Interface Index: Router has 3 devices (d0, d1, d2). Indices are 1, 2, 3.
+    Ipv4Address videoNextHop = topo.GetPeerAddress("router", "primary");  // Cloud IP on Primary
+    Ipv4Address dataNextHop = topo.GetPeerAddress("router", "secondary"); // Cloud IP on Secondary
+    uint32_t primaryIf = topo.GetInterfaceIndex("router", "primary");
+    uint32_t secondaryIf = topo.GetInterfaceIndex("router", "secondary");
+
     Ptr<Ipv4> ipv4Router = router->GetObject<Ipv4>();
     
     // Create and configure the custom PbrRouting instance
-    Ptr<PbrRouting> pbr = CreateObject<PbrRouting>(
-        videoNextHop, 
-        dataNextHop,  
-        2,            // Interface Index for Video path (Net 2)
-        3             // Interface Index for Data path (Net 3)
-    );
-    pbr->SetIpv4(ipv4Router);
-    ipv4Router->SetRoutingProtocol(pbr); // Replace default routing with PBR
+    Ptr<PbrRouting> pbr = CreateObject<PbrRouting>();
+    uint32_t videoEgress = pbr->AddEgress(videoNextHop, primaryIf); // Video path (Net 2)
+    uint32_t dataEgress = pbr->AddEgress(dataNextHop, secondaryIf); // Data path (Net 3)
+
+    // Load-share mode: both classes hash across both links by flow
+    uint32_t sharedGroup = PbrPolicy::NO_GROUP;
+    if (cfg.loadShare) {
+        sharedGroup = pbr->AddLoadShareGroup({videoEgress, dataEgress}, {cfg.primaryWeight, cfg.secondaryWeight});
+    }
+
+    // The policies only steer traffic headed for Cloud: one rule per class and
+    // Cloud subnet, so return traffic towards the studios (TCP ACKs, echo
+    // replies) is left to global routing instead of being sent back to Cloud.
+    for (const char* link : {"primary", "secondary"})
+    {
+        // Policy: Video traffic (EF) uses the Primary path (Net 2)
+        PbrPolicy videoPolicy;
+        videoPolicy.name = std::string("video-ef-") + link;
+        videoPolicy.dscp = 0x2e;
+        videoPolicy.dstPrefix = topo.GetSubnet(link);
+        videoPolicy.dstMask = topo.GetSubnetMask(link);
+        videoPolicy.egress = videoEgress;
+        videoPolicy.group = sharedGroup;
+        videoPolicy.backupEgress = dataEgress;
+        pbr->AddPolicy(videoPolicy);
+
+        // Policy: Data traffic (BE) uses the Secondary path (Net 3)
+        PbrPolicy dataPolicy;
+        dataPolicy.name = std::string("data-be-") + link;
+        dataPolicy.dscp = 0x00;
+        dataPolicy.dstPrefix = topo.GetSubnet(link);
+        dataPolicy.dstMask = topo.GetSubnetMask(link);
+        dataPolicy.egress = dataEgress;
+        dataPolicy.group = sharedGroup;
+        dataPolicy.backupEgress = videoEgress;
+        pbr->AddPolicy(dataPolicy);
+    }
+
+    // Insert PBR into the router's list routing above static (0) and global (-10)
+    // routing, which remain the fallback for traffic no policy matches.
+    Ptr<Ipv4ListRouting> listRouting = DynamicCast<Ipv4ListRouting>(ipv4Router->GetRoutingProtocol());
+    NS_ABORT_MSG_IF(!listRouting, "PBR: router is not using Ipv4ListRouting");
+    listRouting->AddRoutingProtocol(pbr, 10);
+    pbr->SetProfiling(cfg.profile);
+
+    NodeQueueStats routerQueues;
+    routerQueues.Install(router);
+    topo.GetDevice("router", "primary")->TraceConnectWithoutContext("PhyTxEnd", MakeBoundCallback(&CountTxBytes, &result.primaryBytes));
+    topo.GetDevice("router", "secondary")->TraceConnectWithoutContext("PhyTxEnd", MakeBoundCallback(&CountTxBytes, &result.secondaryBytes));
+    bool routerLocal = topo.IsLocal(router);     // Router events and counters live in its partition
+    if (cfg.statsInterval > 0.0 && routerLocal) {
+        Simulator::Schedule(Seconds(cfg.statsInterval), &PrintRouterStats, pbr, &routerQueues, cfg.statsInterval);
+    }
+
+    // Global routing gets Studio's traffic to the Router and backs up PBR
+    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
 
     // --- Traffic Generation (Q2) ---
     uint16_t port = 9;
@@ -180,21 +947,149 @@ int main(int argc, char *argv[])
     videoApp.SetAttribute("PacketSize", UintegerValue(1024));
     videoApp.SetAttribute("DataRate", StringValue("1Mbps"));
     videoApp.SetAttribute("ToS", UintegerValue(0x2e << 2)); // Set ToS for DSCP EF
-    videoApp.Install(studio).Start(Seconds(1.0));
+    for (uint32_t i = 0; i < cfg.flowsPerClass; ++i) {
+        if (topo.IsLocal(studios.Get(i % studios.GetN()))) {
+            videoApp.Install(studios.Get(i % studios.GetN())).Start(Seconds(1.0));
+        }
+    }
 
     // 2. Data Flow (DSCP BE = 0x00, Low Priority)
     OnOffHelper dataApp("ns3::UdpSocketFactory", InetSocketAddress(dataNextHop, port));
     dataApp.SetAttribute("PacketSize", UintegerValue(1024));
     dataApp.SetAttribute("DataRate", StringValue("1Mbps"));
     dataApp.SetAttribute("ToS", UintegerValue(0x00)); // Set ToS for DSCP BE
-    dataApp.Install(studio).Start(Seconds(1.0));
+    for (uint32_t i = 0; i < cfg.flowsPerClass; ++i) {
+        if (topo.IsLocal(studios.Get(i % studios.GetN()))) {
+            dataApp.Install(studios.Get(i % studios.GetN())).Start(Seconds(1.0));
+        }
+    }
 
     // Sink on Cloud node (n2)
-    PacketSinkHelper sink("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), port));
-    sink.Install(cloud).Start(Seconds(0.0));
+    ApplicationContainer sinkApps;
+    if (topo.IsLocal(cloud)) {
+        sinkApps = UdpCountSink::Install(cloud, InetSocketAddress(Ipv4Address::GetAny(), port));
+    }
+    sinkApps.Start(Seconds(0.0));
+
+    // --- Failover scenario: Primary link fails/recovers on the Router ---
+    if (cfg.failPrimaryAt > 0.0 && routerLocal) {
+        Simulator::Schedule(Seconds(cfg.failPrimaryAt), &SetRouterInterface, ipv4Router, primaryIf, false);
+    }
+    if (cfg.restorePrimaryAt > 0.0 && routerLocal) {
+        Simulator::Schedule(Seconds(cfg.restorePrimaryAt), &SetRouterInterface, ipv4Router, primaryIf, true);
+    }
 
     Simulator::Stop(Seconds(10.0));
     Simulator::Run();
+
+    // Every counter is zero outside the partition that simulates its node
+    uint64_t counts[4] = {result.primaryBytes, result.secondaryBytes,
+                          sinkApps.GetN() ? DynamicCast<UdpCountSink>(sinkApps.Get(0))->GetTotalRx() : 0,
+                          pbr->GetFailoverCount()};
+    PartitionReduce(counts, 4, PARTITION_SUM);
+    result.primaryBytes = counts[0];
+    result.secondaryBytes = counts[1];
+    result.cloudRxBytes = counts[2];
+    result.failovers = counts[3];
+    if (!cfg.verbose || !routerLocal) {
+        Simulator::Destroy();
+        return result;
+    }
+    std::cout << "\n=== PBR Failover Summary ===\n";
+    std::cout << "Failovers: " << pbr->GetFailoverCount() << ", Restores: " << pbr->GetRestoreCount() << "\n";
+    const std::vector<PbrFailoverEvent>& events = pbr->GetFailoverEvents();
+    for (uint32_t i = 0; i < events.size(); ++i)
+    {
+        std::cout << "  t=" << events[i].time.GetSeconds() << "s interface " << events[i].interface
+                  << (events[i].up ? " UP" : " DOWN") << ", policies switched: " << events[i].policiesAffected << "\n";
+    }
+    std::cout << "Cloud received: " << result.cloudRxBytes << " bytes\n";
+    PrintRouterStats(pbr, &routerQueues, 0.0);
+
     Simulator::Destroy();
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    PbrConfig cfg;
+    std::string scheduler = "map";
+    bool benchmark = false;
+    std::string benchSchedulers = "map,calendar,radix";
+    std::string benchNodes = "1,16,64";
+    std::string benchFlows = "1,16,64";
+    std::string benchOutput = "scratch/pbr-benchmark.csv";
+    std::string golden;
+    bool goldenRecord = false;
+    bool distributed = false;
+
+    CommandLine cmd;
+    cmd.AddValue("loadShare", "Spread both classes over the parallel links instead of pinning each to one", cfg.loadShare);
+    cmd.AddValue("primaryWeight", "Load-share weight of the Primary link (Net 2)", cfg.primaryWeight);
+    cmd.AddValue("secondaryWeight", "Load-share weight of the Secondary link (Net 3)", cfg.secondaryWeight);
+    cmd.AddValue("flowsPerClass", "OnOff flows per DSCP class (each gets its own source port)", cfg.flowsPerClass);
+    cmd.AddValue("studios", "Studio nodes behind the Router sharing the flows", cfg.studios);
+    cmd.AddValue("failPrimaryAt", "Time (s) to take the Primary link down on the Router, 0 = never", cfg.failPrimaryAt);
+    cmd.AddValue("restorePrimaryAt", "Time (s) to bring the Primary link back up, 0 = never", cfg.restorePrimaryAt);
+    cmd.AddValue("topology", "Topology file (needs studio/router/cloud and access/primary/secondary links)", cfg.topologyFile);
+    cmd.AddValue("profile", "Record RouteOutput/RouteInput latency histograms", cfg.profile);
+    cmd.AddValue("statsInterval", "Print the router counters every N seconds, 0 = only at the end", cfg.statsInterval);
+    cmd.AddValue("scheduler", "Event scheduler: map, list, heap, calendar, priority or radix", scheduler);
+    cmd.AddValue("benchmark", "Run the scheduler benchmark instead of a single simulation", benchmark);
+    cmd.AddValue("benchSchedulers", "Benchmark: schedulers, comma-separated", benchSchedulers);
+    cmd.AddValue("benchNodes", "Benchmark: studio nodes, comma-separated", benchNodes);
+    cmd.AddValue("benchFlows", "Benchmark: flows per class, comma-separated", benchFlows);
+    cmd.AddValue("benchOutput", "Benchmark: results CSV", benchOutput);
+    cmd.AddValue("golden", "Check one headless run against the bands in this golden file (exit 1 on failure)", golden);
+    cmd.AddValue("goldenRecord", "Record the golden bands from this run instead of checking them", goldenRecord);
+    cmd.AddValue("distributed", "One process per site (needs ns-3 with MPI; run under mpirun)", distributed);
+    cmd.Parse(argc, argv);
+
+    if (distributed) {
+        NS_ABORT_MSG_IF(benchmark || !golden.empty(), "--distributed runs a single simulation (no --benchmark or --golden)");
+#ifdef NS3_MPI
+        SelectScheduler(scheduler);
+        GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::DistributedSimulatorImpl"));
+        MpiInterface::Enable(&argc, &argv);
+        cfg.systems = MpiInterface::GetSize();
+        cfg.systemId = MpiInterface::GetSystemId();
+        RunPbrScenario(cfg);
+        MpiInterface::Disable();
+        return 0;
+#else
+        NS_FATAL_ERROR("--distributed needs ns-3 configured with --enable-mpi");
+#endif
+    }
+
+    if (benchmark) {
+        RunSchedulerBenchmark("pbr", ExpandSchedulerBenchmark(benchSchedulers, benchNodes, benchFlows),
+            [&cfg](const SchedulerBenchmarkCase& c) {
+                PbrConfig bench = cfg;
+                bench.studios = std::max(1u, c.nodes);
+                bench.flowsPerClass = c.flows;
+                bench.statsInterval = 0.0;
+                bench.verbose = false;
+                RunPbrScenario(bench);
+            }, benchOutput);
+        return 0;
+    }
+
+    SelectScheduler(scheduler);
+    if (!golden.empty()) {
+        // Regression gate: per-link byte split, delivery, failovers, events and wall time
+        LogComponentDisableAll(LOG_LEVEL_ALL);
+        cfg.verbose = false;
+        cfg.statsInterval = 0.0;
+        RegressionGate gate("pbr", golden, goldenRecord);
+        gate.Watch();
+        PbrRunResult r = RunPbrScenario(cfg);
+        uint64_t sent = r.primaryBytes + r.secondaryBytes;
+        double primaryPct = sent ? r.primaryBytes * 100.0 / sent : 0.0;
+        gate.Check("primarySharePct", primaryPct, 5.0);
+        gate.Check("cloudRxMB", r.cloudRxBytes / 1e6, r.cloudRxBytes / 1e6 * 0.05);
+        gate.Check("failovers", r.failovers, 0.0);
+        return gate.Finish() ? 0 : 1;
+    }
+    RunPbrScenario(cfg);
     return 0;
 }
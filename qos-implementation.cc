@@ -1,8 +1,38 @@
 /*
  * Exercise 2: Quality of Service Implementation for Mixed Traffic
- * Implements: Traffic Differentiation (Q1), Priority Queueing (Q2), 
+ * Implements: Traffic Differentiation (Q1), Priority Queueing (Q2, DSCP strict priority + DRR), 
  * Performance Measurement (Q3), and Congestion Scenario (Q4).
  * Topology: Triangular Mesh (n0, n1, n2) | Bottleneck link is n0 <-> n2 (5Mbps).
+ * The mesh is described by QosTopology() (or a --topology file) and built by WanTopology.
+ * Sweep mode (--sweep) runs the cartesian product of parameter lists/ranges as
+ * independent forked processes across all cores and merges the per-run
+ * FlowMonitor results into one CSV table. With --warmup=<s> the combinations
+ * whose warm-up is identical (same rates, packet sizes, run and length) share
+ * it: it is simulated once and each combination continues from a copy-on-write
+ * fork of it, measuring from the fork on. --warmupRetune also shares it between
+ * combinations that only differ in bottleneck rate (and, for OnOff sources,
+ * rates and packet sizes), retuning them at the fork; those start measuring from
+ * another combination's state, and the sweep lists them.
+ * --timeSeries=<file> additionally samples per-class throughput, loss, delay and
+ * bottleneck queue depth every --timeSeriesInterval from trace sources (no flow
+ * map walks) and streams the records through a background writer.
+ * --aqm=codel|ecn puts best effort behind flow-queued CoDel to measure how much
+ * bufferbloat it removes on the bottleneck.
+ * --contracts polices or shapes DSCP classes to two-rate token-bucket contracts.
+ * --traffic=models replaces the OnOff sources with --voipFlows Brady-model VoIP
+ * calls, --ftpFlows TCP bulk transfers and --videoFlows GOP video streams;
+ * --traffic=trace replays --trafficTrace (inter-arrival, size, DSCP per line)
+ * on --traceFlows flows.
+ * --sites=N moves the sources onto N branch sites behind HQ, sharing the flows
+ * round-robin; --scheduler picks the event queue, and --benchmark runs the
+ * scenario for every --benchSchedulers x --benchNodes (sites) x --benchFlows
+ * case, reporting events/s, wall time and peak RSS per case.
+ * --golden=<file> runs headless and gates the result on the file's tolerance
+ * bands (see regression-gate.h and regression.sh).
+ * --distributed (ns-3 built with MPI, e.g. mpirun -np 3) simulates HQ, Branch,
+ * DC and every branch site in its own partition; the per-class results are
+ * counted where each flow's source and sink are simulated and summed over the
+ * partitions (see QosFlowAggregator).
  */
 
 #include "ns3/applications-module.h"
@@ -12,193 +42,2094 @@
 #include "ns3/point-to-point-module.h"
 #include "ns3/traffic-control-module.h" 
 #include "ns3/flow-monitor-module.h"    
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
 #include <iomanip>                      // Required for std::setprecision
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "background-writer.h"
+#include "hot-path-stats.h"
+#include "partition-reduce.h"
+#include "regression-gate.h"
+#include "scheduler-benchmark.h"
+#include "traffic-generator.h"
+#include "udp-count-sink.h"
+#include "wan-topology.h"
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("QoSImplementation");
 
-const std::string LINK_DATA_RATE = "5Mbps"; // Link Capacity (Bottleneck)
-const double SIMULATION_TIME = 15.0;       // Total Simulation Time
+// Scenario parameters; the defaults reproduce the original exercise
+struct QosConfig
+{
+    std::string linkRate = "5Mbps";     // Link Capacity (Bottleneck)
+    double simTime = 15.0;              // Total Simulation Time
+    std::string voipRate = "2Mbps";
+    std::string ftpRate = "4Mbps";
+    uint32_t voipPacketSize = 200;
+    uint32_t ftpPacketSize = 1500;
+    uint32_t run = 1;                   // RNG run number; each run is an independent replica
+    std::string topologyFile;
+    bool verbose = true;                // Component logging and the console report
+    double delayBinWidth = 0.0001;      // FlowMonitor delay histogram resolution (s) for percentiles
+    std::string timeSeriesFile;         // Empty = no time series
+    double timeSeriesInterval = 0.1;    // Sampling period (s)
+    bool timeSeriesBinary = false;      // Packed binary records instead of CSV
+    std::string aqm = "none";           // Best-effort AQM: none, codel or ecn
+    double aqmTarget = 0.005;           // CoDel sojourn target (s)
+    double aqmInterval = 0.1;           // CoDel interval (s)
+    uint32_t aqmLimit = 1000;           // Packets over all best-effort flow queues
+    std::string contracts;              // Class contracts, see ApplyClassContracts()
+    std::string traffic = "onoff";      // Sources: onoff, models or trace
+    uint32_t voipFlows = 1;             // models: VoIP calls
+    uint32_t ftpFlows = 1;              // models: TCP bulk transfers
+    uint32_t videoFlows = 0;            // models: AF41 video streams (load only, not a reporting class)
+    std::string videoRate = "1Mbps";    // models: mean rate per video stream
+    std::string trafficTrace;           // trace: replayed file
+    uint32_t traceFlows = 1;            // trace: flows replaying it
+    uint32_t sites = 0;                 // Source sites behind HQ; 0 = sources on n0
+    double warmup = 0.0;                // Sweep: warm-up (s) simulated once per group and forked; 0 = off
+    bool warmupRetune = false;          // Sweep: share warm-ups across rates and sizes, retuned at the fork
+    uint32_t systems = 1;               // Partitions of a distributed run
+    uint32_t systemId = 0;              // Partition simulated by this process
+};
+
+// Per-class FlowMonitor results of one run
+struct QosClassResult
+{
+    double txPackets = 0;
+    double rxPackets = 0;
+    double lossPct = 0;
+    double delayMs = 0;
+    double jitterMs = 0;
+    double throughputMbps = 0;
+    double p50DelayMs = 0;
+    double p99DelayMs = 0;
+    double p999DelayMs = 0;
+};
+
+struct QosRunResult
+{
+    QosClassResult voip;
+    QosClassResult ftp;
+};
+
+// One warm-started sweep group: the scenario of variants[0] is simulated up to
+// cfg.warmup once, then every variant continues in its own copy-on-write fork of
+// that process (with --warmupRetune, after its linkRate / OnOff rates and sizes
+// are applied). Fork() returns
+// the variant index in a child and -1 in the warm-up process once all are done;
+// the children report through Finish(), which never returns.
+class QosWarmStart
+{
+public:
+    QosWarmStart(const std::vector<QosConfig>& variants, uint32_t jobs)
+    : m_variants(variants), m_rows(variants.size()), m_jobs(jobs), m_fd(-1)
+    {}
+
+    const QosConfig& GetVariant(int index) const { return m_variants[index]; }
+    const std::string& GetRow(uint32_t index) const { return m_rows[index]; }
+    uint32_t GetN() const { return m_variants.size(); }
+
+    int Fork();
+    void Finish(int index, const QosRunResult& result);
+
+private:
+    std::vector<QosConfig> m_variants;
+    std::vector<std::string> m_rows;    // Sweep rows, empty if the variant failed
+    uint32_t m_jobs;
+    int m_fd;                           // Child: write end of its pipe
+};
+
+// Triangular mesh; the n0 -> n2 route forces Branch-bound traffic over the bottleneck
+// Each extra site hangs off HQ on its own access link; every node is its own site
+std::string QosTopology(const QosConfig& cfg)
+{
+    std::ostringstream sites;
+    sites << "pool 10.64.0.0/10 30\n";
+    for (uint32_t i = 1; i <= cfg.sites; ++i)
+    {
+        sites << "node s" << i << " site=" << i + 2 << "\nlink access" << i << " s" << i << " n0 rate=100Mbps delay=1ms\n";
+    }
+    return "defaults queue=100p\n"                                        // Base Queue
+           "node n0 site=0\n"                                             // HQ
+           "node n1 site=1\n"                                             // Branch
+           "node n2 site=2\n"                                             // DC
+           "link link1 n0 n1 rate=100Mbps delay=1ms subnet=10.1.1.0/24\n"  // HQ <-> Branch
+           "link link2 n1 n2 rate=100Mbps delay=1ms subnet=10.1.2.0/24\n"  // Branch <-> DC
+           "link bottleneck n0 n2 rate=" + cfg.linkRate + " delay=10ms subnet=10.1.3.0/24\n" // Q4
+           "route n0 10.1.2.0/24 via bottleneck metric=0\n" + sites.str();
+}
+
+// =================================================================
+// Flow-Queued CoDel Queue Disc (Self-Contained)
+// =================================================================
 
-// --- Q2: Function to Configure and Install PfifoFastQueueDisc ---
-void InstallQoS(Ptr<NetDevice> device)
+// FQ-CoDel style AQM: packets are hashed on their 5-tuple into a fixed set of
+// flow queues served by DRR, with newly active (sparse) flows ahead of old ones.
+// Each flow runs CoDel on the sojourn time of its head packet and drops, or ECN
+// marks, once the sojourn stays above target for a whole interval. All per-flow
+// scheduling and CoDel state lives in one compact array indexed by flow.
+class FlowCodelQueueDisc : public QueueDisc
 {
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::FlowCodelQueueDisc")
+            .SetParent<QueueDisc>()
+            .SetGroupName("TrafficControl")
+            .AddConstructor<FlowCodelQueueDisc>();
+        return tid;
+    }
+
+    FlowCodelQueueDisc()
+    : QueueDisc(QueueDiscSizePolicy::NO_LIMITS), m_nFlows(1024), m_limit(10240), m_quantum(1514),
+      m_target(MilliSeconds(5)), m_interval(MilliSeconds(100)), m_useEcn(false), m_perturbation(0), m_backlog(0)
+    {}
+
+    void SetFlows(uint32_t flows) { m_nFlows = flows; }
+    void SetLimit(uint32_t packets) { m_limit = packets; }
+    void SetQuantum(uint32_t bytes) { m_quantum = bytes; }
+    void SetTarget(Time target) { m_target = target; }
+    void SetInterval(Time interval) { m_interval = interval; }
+    void SetUseEcn(bool useEcn) { m_useEcn = useEcn; }
+    void SetPerturbation(uint32_t perturbation) { m_perturbation = perturbation; }
+
+protected:
+    virtual bool DoEnqueue(Ptr<QueueDiscItem> item) override {
+        uint32_t flow = item->Hash(m_perturbation) % m_nFlows;
+        if (!GetInternalQueue(flow)->Enqueue(item)) {
+            return false;
+        }
+        FlowState& f = m_flows[flow];
+        f.backlog += item->GetSize();
+        if (f.status == INACTIVE) {
+            f.status = NEW_FLOW;
+            f.deficit = m_quantum;
+            PushBack(m_newFlows, flow);
+        }
+        if (++m_backlog > m_limit) {
+            DropFromFattestFlow();
+        }
+        return true;
+    }
+
+    virtual Ptr<QueueDiscItem> DoDequeue(void) override {
+        while (true)
+        {
+            FlowList* list = m_newFlows.head != NONE ? &m_newFlows : &m_oldFlows;
+            if (list->head == NONE) {
+                return 0;
+            }
+            uint32_t flow = list->head;
+            FlowState& f = m_flows[flow];
+
+            if (f.deficit <= 0) {
+                f.deficit += m_quantum;
+                PopFront(*list);
+                f.status = OLD_FLOW;
+                PushBack(m_oldFlows, flow);
+                continue;
+            }
+
+            Ptr<QueueDiscItem> item = CodelDequeue(flow);
+            if (!item) {
+                PopFront(*list);
+                // An emptied new flow goes to the old list once, so it cannot
+                // starve old flows by repeatedly re-entering as new
+                if (list == &m_newFlows && m_oldFlows.head != NONE) {
+                    f.status = OLD_FLOW;
+                    PushBack(m_oldFlows, flow);
+                } else {
+                    f.status = INACTIVE;
+                }
+                continue;
+            }
+            f.deficit -= item->GetSize();
+            return item;
+        }
+    }
+
+    virtual bool CheckConfig(void) override {
+        if (GetNQueueDiscClasses() > 0 || GetNPacketFilters() > 0) {
+            NS_LOG_ERROR("FlowCodelQueueDisc hashes flows itself and takes no child classes or filters");
+            return false;
+        }
+        if (m_nFlows == 0 || m_limit == 0) {
+            NS_LOG_ERROR("FlowCodelQueueDisc needs at least one flow queue and a packet limit");
+            return false;
+        }
+        if (GetNInternalQueues() == 0) {
+            for (uint32_t i = 0; i < m_nFlows; ++i)
+            {
+                AddInternalQueue(CreateObjectWithAttributes<DropTailQueue<QueueDiscItem> >(
+                    "MaxSize", QueueSizeValue(QueueSize(QueueSizeUnit::PACKETS, m_limit))));
+            }
+        }
+        return GetNInternalQueues() == m_nFlows;
+    }
+
+    virtual void InitializeParams(void) override {
+        m_flows.assign(m_nFlows, FlowState());
+        m_newFlows = FlowList();
+        m_oldFlows = FlowList();
+        m_backlog = 0;
+    }
+
+private:
+    static constexpr uint32_t NONE = 0xffffffff;
+    enum FlowStatus : uint8_t { INACTIVE, NEW_FLOW, OLD_FLOW };
+
+    struct FlowState
+    {
+        int32_t deficit = 0;
+        uint32_t next = NONE;           // Link in the new or old flow list
+        uint32_t backlog = 0;           // Bytes
+        uint32_t count = 0;             // CoDel drops in the current dropping state
+        uint32_t lastCount = 0;
+        FlowStatus status = INACTIVE;
+        bool dropping = false;
+        Time firstAboveTime;            // Zero while below target
+        Time dropNext;
+    };
+
+    struct FlowList
+    {
+        uint32_t head = NONE;
+        uint32_t tail = NONE;
+    };
+
+    void PushBack(FlowList& list, uint32_t flow)
+    {
+        m_flows[flow].next = NONE;
+        if (list.tail == NONE) {
+            list.head = flow;
+        } else {
+            m_flows[list.tail].next = flow;
+        }
+        list.tail = flow;
+    }
+
+    void PopFront(FlowList& list)
+    {
+        uint32_t flow = list.head;
+        list.head = m_flows[flow].next;
+        if (list.head == NONE) {
+            list.tail = NONE;
+        }
+        m_flows[flow].next = NONE;
+    }
+
+    Ptr<QueueDiscItem> TakeHead(uint32_t flow)
+    {
+        Ptr<QueueDiscItem> item = GetInternalQueue(flow)->Dequeue();
+        if (item) {
+            m_flows[flow].backlog -= item->GetSize();
+            --m_backlog;
+        }
+        return item;
+    }
+
+    // Sojourn check of RFC 8289: true once the head has been above target for an interval
+    bool OkToDrop(FlowState& f, Ptr<const QueueDiscItem> item, Time now)
+    {
+        if (now - item->GetTimeStamp() < m_target || f.backlog <= m_quantum) {
+            f.firstAboveTime = Time(0);
+            return false;
+        }
+        if (f.firstAboveTime.IsZero()) {
+            f.firstAboveTime = now + m_interval;
+            return false;
+        }
+        return now >= f.firstAboveTime;
+    }
+
+    Time ControlLaw(Time t, uint32_t count) const
+    {
+        return t + Seconds(m_interval.GetSeconds() / std::sqrt(static_cast<double>(count)));
+    }
+
+    // Drops (or marks, when ECN is on and the packet is ECN capable) the item.
+    // Returns true when the item was marked and should still be sent.
+    bool Signal(Ptr<QueueDiscItem> item)
+    {
+        if (m_useEcn && Mark(item, "Sojourn time above target")) {
+            return true;
+        }
+        DropAfterDequeue(item, "Sojourn time above target");
+        return false;
+    }
+
+    Ptr<QueueDiscItem> CodelDequeue(uint32_t flow)
+    {
+        FlowState& f = m_flows[flow];
+        Time now = Simulator::Now();
+        Ptr<QueueDiscItem> item = TakeHead(flow);
+        if (!item) {
+            f.dropping = false;
+            return item;
+        }
+        bool okToDrop = OkToDrop(f, item, now);
+
+        if (f.dropping) {
+            if (!okToDrop) {
+                f.dropping = false;
+            }
+            while (f.dropping && now >= f.dropNext)
+            {
+                ++f.count;
+                if (Signal(item)) {
+                    f.dropNext = ControlLaw(f.dropNext, f.count);
+                    return item;
+                }
+                item = TakeHead(flow);
+                if (!item || !OkToDrop(f, item, now)) {
+                    f.dropping = false;
+                } else {
+                    f.dropNext = ControlLaw(f.dropNext, f.count);
+                }
+            }
+        } else if (okToDrop) {
+            bool marked = Signal(item);
+            if (!marked) {
+                item = TakeHead(flow);
+            }
+            f.dropping = true;
+            // Resume near the previous drop rate if the last dropping state ended recently
+            uint32_t delta = f.count - f.lastCount;
+            f.count = (delta > 1 && now - f.dropNext < m_interval * 16) ? delta : 1;
+            f.lastCount = f.count;
+            f.dropNext = ControlLaw(now, f.count);
+        }
+        return item;
+    }
+
+    // Over the packet limit: drop the head of the flow with the largest backlog
+    void DropFromFattestFlow()
+    {
+        uint32_t fattest = 0;
+        for (uint32_t i = 1; i < m_nFlows; ++i)
+        {
+            if (m_flows[i].backlog > m_flows[fattest].backlog) {
+                fattest = i;
+            }
+        }
+        Ptr<QueueDiscItem> item = TakeHead(fattest);
+        if (item) {
+            DropAfterDequeue(item, "Flow queue limit exceeded");
+        }
+    }
+
+    uint32_t m_nFlows;
+    uint32_t m_limit;                   // Packets over all flows
+    uint32_t m_quantum;
+    Time m_target;
+    Time m_interval;
+    bool m_useEcn;
+    uint32_t m_perturbation;
+    uint32_t m_backlog;                 // Packets over all flows
+    std::vector<FlowState> m_flows;
+    FlowList m_newFlows;
+    FlowList m_oldFlows;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(FlowCodelQueueDisc);
+
+// =================================================================
+// Two-Rate Token Bucket (Class Contracts)
+// =================================================================
+
+// Committed (CIR/CBS) and peak (PIR/PBS) buckets in the spirit of RFC 2698.
+// Tokens are bytes and are refilled lazily from the time elapsed since the last
+// use, so a contract costs nothing while its class is idle and needs no timers.
+struct QosTokenBucket
+{
+    double cir = 0;         // Bytes per second
+    double pir = 0;
+    double cbs = 0;         // Bytes
+    double pbs = 0;
+    double committed = 0;
+    double peak = 0;
+    Time last;
+
+    enum Color { GREEN, YELLOW, RED };
+
+    void Reset(Time now) { committed = cbs; peak = pbs; last = now; }
+
+    void Refill(Time now)
+    {
+        double elapsed = (now - last).GetSeconds();
+        last = now;
+        committed = std::min(cbs, committed + elapsed * cir);
+        peak = std::min(pbs, peak + elapsed * pir);
+    }
+
+    // Policing: strict conformance of a packet of the given size
+    Color Meter(uint32_t bytes, Time now)
+    {
+        Refill(now);
+        if (peak < bytes) {
+            return RED;
+        }
+        peak -= bytes;
+        if (committed < bytes) {
+            return YELLOW;
+        }
+        committed -= bytes;
+        return GREEN;
+    }
+
+    // Shaping: a class may send while its tokens are positive and pays afterwards,
+    // so the head packet's size need not be known up front
+    Color State(Time now)
+    {
+        Refill(now);
+        return peak <= 0 ? RED : committed <= 0 ? YELLOW : GREEN;
+    }
+
+    void Charge(uint32_t bytes)
+    {
+        if (committed > 0) {
+            committed -= bytes;
+        }
+        peak -= bytes;
+    }
+
+    // Time until a red bucket may send again
+    Time TimeToPeak() const { return Seconds(-peak / pir) + NanoSeconds(1); }
+};
+
+// =================================================================
+// DSCP Strict-Priority + DRR Queue Disc (Self-Contained)
+// =================================================================
+
+// Classifies on the full 6-bit DSCP through a 64-entry table. Strict-priority
+// classes are served first, lowest index first, via a backlog bitmap; the
+// remaining classes share what is left by deficit round robin over a fixed ring
+// of active classes. Every class has its own byte-limited FIFO, or a child queue
+// disc (e.g. FlowCodelQueueDisc) when it needs AQM, so enqueue and dequeue are
+// O(1) and the scheduler never allocates after initialization.
+// A class may carry a two-rate contract. Policed classes drop red packets on
+// enqueue. Shaped classes are scheduled like HTB: within CIR they compete at
+// their normal priority, between CIR and PIR they only borrow capacity no green
+// class wants, and above PIR they wait. The queue disc then arms a single wake-up
+// for the earliest class to turn eligible again instead of any per-packet timer.
+class DscpPrioQueueDisc : public QueueDisc
+{
+public:
+    static constexpr uint32_t MAX_CLASSES = 32;    // Strict backlog is a 32-bit mask
+    static constexpr uint8_t DSCP_VALUES = 64;
+
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::DscpPrioQueueDisc")
+            .SetParent<QueueDisc>()
+            .SetGroupName("TrafficControl")
+            .AddConstructor<DscpPrioQueueDisc>();
+        return tid;
+    }
+
+    enum ContractMode { UNLIMITED, POLICE, SHAPE };
+
+    DscpPrioQueueDisc()
+    : QueueDisc(QueueDiscSizePolicy::NO_LIMITS), m_defaultClass(0), m_strictBacklog(0),
+      m_activeHead(0), m_activeCount(0), m_shaped(false)
+    {
+        std::fill(m_dscpClass, m_dscpClass + DSCP_VALUES, UNMAPPED);
+    }
+
+    // Returns the class index. quantum is the DRR share in bytes per round and is
+    // ignored for strict classes; maxBytes caps the class backlog.
+    uint32_t AddClass(const std::string& name, bool strict, uint32_t quantum, uint32_t maxBytes)
+    {
+        NS_ABORT_MSG_IF(m_classes.size() >= MAX_CLASSES, "DscpPrioQueueDisc: too many classes");
+        NS_ABORT_MSG_IF(!strict && quantum == 0, "DscpPrioQueueDisc: DRR class " << name << " needs a quantum");
+        DscpClass c;
+        c.name = name;
+        c.strict = strict;
+        c.quantum = quantum;
+        c.maxBytes = maxBytes;
+        m_classes.push_back(c);
+        return m_classes.size() - 1;
+    }
+
+    // Queues the class in a child queue disc instead of a FIFO; the child enforces its own limits
+    void SetClassQueueDisc(uint32_t cls, Ptr<QueueDisc> child) { m_classes[cls].child = child; }
+
+    // Rates in bits per second, bursts in bytes
+    void SetClassContract(uint32_t cls, ContractMode mode, uint64_t cir, uint32_t cbs, uint64_t pir, uint32_t pbs)
+    {
+        NS_ABORT_MSG_IF(mode != UNLIMITED && (pir < cir || pir == 0 || pbs == 0),
+                        "DscpPrioQueueDisc: class " << m_classes[cls].name << " needs PIR >= CIR and a peak burst");
+        DscpClass& c = m_classes[cls];
+        c.mode = mode;
+        c.bucket.cir = cir / 8.0;
+        c.bucket.pir = pir / 8.0;
+        c.bucket.cbs = cbs;
+        c.bucket.pbs = pbs;
+        c.bucket.Reset(Simulator::Now());
+        m_shaped = false;
+        for (const DscpClass& other : m_classes)
+        {
+            m_shaped = m_shaped || other.mode == SHAPE;
+        }
+    }
+
+    // Returns the class index of the given name, or GetNClasses() if there is none
+    uint32_t GetClassByName(const std::string& name) const
+    {
+        uint32_t cls = 0;
+        while (cls < m_classes.size() && m_classes[cls].name != name)
+        {
+            ++cls;
+        }
+        return cls;
+    }
+
+    void MapDscp(uint8_t dscp, uint32_t cls) { m_dscpClass[dscp & 0x3f] = cls; }
+
+    // Class for DSCP values that were not mapped explicitly
+    void SetDefaultClass(uint32_t cls) { m_defaultClass = cls; }
+
+    uint32_t GetNClasses() const { return m_classes.size(); }
+    const std::string& GetClassName(uint32_t cls) const { return m_classes[cls].name; }
+    uint32_t GetClassOfDscp(uint8_t dscp) const { return m_dscpClass[dscp & 0x3f]; }
+
+protected:
+    virtual void DoDispose(void) override {
+        m_wakeEvent.Cancel();   // A pending wake-up would Run a disposed queue disc
+        QueueDisc::DoDispose();
+    }
+
+    virtual bool DoEnqueue(Ptr<QueueDiscItem> item) override {
+        uint8_t tos = 0;
+        item->GetUint8Value(QueueItem::IP_DSFIELD, tos);
+        uint32_t cls = m_dscpClass[tos >> 2];
+        DscpClass& c = m_classes[cls];
+
+        if (c.mode == POLICE && c.bucket.Meter(item->GetSize(), Simulator::Now()) == QosTokenBucket::RED) {
+            DropBeforeEnqueue(item, "Exceeds class peak rate");
+            return false;
+        }
+
+        // A full class FIFO or child drops the packet itself and reports it through this queue disc
+        bool wasEmpty = IsClassEmpty(c);
+        if (!(c.child ? c.child->Enqueue(item) : GetInternalQueue(c.index)->Enqueue(item))) {
+            return false;
+        }
+        if (wasEmpty) {
+            if (c.strict) {
+                m_strictBacklog |= 1u << cls;
+            } else {
+                c.deficit = c.quantum;
+                m_active[(m_activeHead + m_activeCount) % m_active.size()] = cls;
+                ++m_activeCount;
+            }
+        }
+        return true;
+    }
+
+    virtual Ptr<QueueDiscItem> DoDequeue(void) override {
+        Time now = Simulator::Now();
+        Ptr<QueueDiscItem> item = DequeueEligible(now, false);
+        if (!item && m_shaped) {
+            // Nothing within its committed rate: let shaped classes borrow up to PIR
+            item = DequeueEligible(now, true);
+            if (!item) {
+                ScheduleWake();
+            }
+        }
+        return item;
+    }
+
+    virtual bool CheckConfig(void) override {
+        if (GetNPacketFilters() > 0) {
+            NS_LOG_ERROR("DscpPrioQueueDisc classifies on DSCP itself and takes no packet filters");
+            return false;
+        }
+        if (m_classes.empty() || m_defaultClass >= m_classes.size()) {
+            NS_LOG_ERROR("DscpPrioQueueDisc needs at least one class and a valid default class");
+            return false;
+        }
+        if (GetNInternalQueues() == 0 && GetNQueueDiscClasses() == 0) {
+            for (DscpClass& c : m_classes)
+            {
+                if (c.child) {
+                    Ptr<QueueDiscClass> qdClass = CreateObject<QueueDiscClass>();
+                    qdClass->SetQueueDisc(c.child);
+                    c.index = GetNQueueDiscClasses();
+                    AddQueueDiscClass(qdClass);
+                } else {
+                    c.index = GetNInternalQueues();
+                    AddInternalQueue(CreateObjectWithAttributes<DropTailQueue<QueueDiscItem> >(
+                        "MaxSize", QueueSizeValue(QueueSize(QueueSizeUnit::BYTES, c.maxBytes))));
+                }
+            }
+        }
+        return GetNInternalQueues() + GetNQueueDiscClasses() == m_classes.size();
+    }
+
+    virtual void InitializeParams(void) override {
+        for (uint32_t dscp = 0; dscp < DSCP_VALUES; ++dscp)
+        {
+            if (m_dscpClass[dscp] == UNMAPPED) {
+                m_dscpClass[dscp] = m_defaultClass;
+            }
+        }
+        m_active.assign(m_classes.size(), 0);
+        m_activeHead = 0;
+        m_activeCount = 0;
+        m_strictBacklog = 0;
+    }
+
+private:
+    static constexpr uint32_t UNMAPPED = 0xffffffff;
+
+    struct DscpClass
+    {
+        std::string name;
+        bool strict = false;
+        uint32_t quantum = 0;
+        uint32_t maxBytes = 0;
+        int32_t deficit = 0;
+        ContractMode mode = UNLIMITED;
+        QosTokenBucket bucket;
+        Ptr<QueueDisc> child;
+        uint32_t index = 0;             // Internal queue, or queue disc class when child is set
+    };
+
+    bool IsEligible(DscpClass& c, Time now, bool borrow)
+    {
+        if (c.mode != SHAPE) {
+            return !borrow;
+        }
+        QosTokenBucket::Color color = c.bucket.State(now);
+        return color == QosTokenBucket::GREEN || (borrow && color == QosTokenBucket::YELLOW);
+    }
+
+    // One scheduling pass: strict classes in priority order, then a DRR round.
+    // Ineligible classes are skipped without earning DRR credit.
+    Ptr<QueueDiscItem> DequeueEligible(Time now, bool borrow)
+    {
+        for (uint32_t pending = m_strictBacklog; pending; pending &= pending - 1)
+        {
+            uint32_t cls = __builtin_ctz(pending);
+            DscpClass& c = m_classes[cls];
+            if (!IsEligible(c, now, borrow)) {
+                continue;
+            }
+            Ptr<QueueDiscItem> item = DequeueClass(c);
+            if (IsClassEmpty(c)) {
+                m_strictBacklog &= ~(1u << cls);
+            }
+            if (item) {
+                Charge(c, item);
+                return item;
+            }
+        }
+
+        uint32_t skipped = 0;
+        while (skipped < m_activeCount)
+        {
+            uint32_t cls = m_active[m_activeHead];
+            DscpClass& c = m_classes[cls];
+            bool eligible = IsEligible(c, now, borrow);
+
+            if (!eligible || c.deficit <= 0) {
+                // Out of credit: top up and move to the back of the round
+                if (eligible) {
+                    c.deficit += c.quantum;
+                } else {
+                    ++skipped;
+                }
+                m_activeHead = (m_activeHead + 1) % m_active.size();
+                m_active[(m_activeHead + m_activeCount - 1) % m_active.size()] = cls;
+                continue;
+            }
+
+            // An AQM child may drop its whole backlog and return nothing
+            Ptr<QueueDiscItem> item = DequeueClass(c);
+            if (IsClassEmpty(c)) {
+                m_activeHead = (m_activeHead + 1) % m_active.size();
+                --m_activeCount;
+            }
+            if (item) {
+                c.deficit -= item->GetSize();
+                Charge(c, item);
+                return item;
+            }
+        }
+        return 0;
+    }
+
+    void Charge(DscpClass& c, Ptr<const QueueDiscItem> item)
+    {
+        if (c.mode == SHAPE) {
+            c.bucket.Charge(item->GetSize());
+        }
+    }
+
+    // Every backlogged class is above its peak rate: wake up when the first one recovers
+    void ScheduleWake()
+    {
+        Time wake = Time::Max();
+        for (const DscpClass& c : m_classes)
+        {
+            if (c.mode == SHAPE && c.bucket.peak <= 0 && !IsClassEmpty(c)) {
+                wake = std::min(wake, c.bucket.TimeToPeak());
+            }
+        }
+        if (wake == Time::Max()) {
+            return;
+        }
+        if (m_wakeEvent.IsRunning()) {
+            if (Simulator::GetDelayLeft(m_wakeEvent) <= wake) {
+                return;
+            }
+            m_wakeEvent.Cancel();
+        }
+        m_wakeEvent = Simulator::Schedule(wake, &QueueDisc::Run, this);
+    }
+
+    bool IsClassEmpty(const DscpClass& c)
+    {
+        return c.child ? c.child->GetNPackets() == 0 : GetInternalQueue(c.index)->IsEmpty();
+    }
+
+    Ptr<QueueDiscItem> DequeueClass(const DscpClass& c)
+    {
+        return c.child ? c.child->Dequeue() : GetInternalQueue(c.index)->Dequeue();
+    }
+
+    std::vector<DscpClass> m_classes;
+    uint32_t m_dscpClass[DSCP_VALUES];
+    uint32_t m_defaultClass;
+    uint32_t m_strictBacklog;               // Bit per strict class with packets queued
+    std::vector<uint32_t> m_active;         // Ring of backlogged DRR classes
+    uint32_t m_activeHead;
+    uint32_t m_activeCount;
+    bool m_shaped;                          // Any class shaped, so borrowing and wake-ups apply
+    EventId m_wakeEvent;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(DscpPrioQueueDisc);
+
+// Applies "class:police|shape:CIR:CBS:PIR:PBS[,...]" contracts, e.g.
+// "ef:police:1Mbps:3000:2Mbps:6000,be:shape:2Mbps:15000:3Mbps:30000"
+void ApplyClassContracts(Ptr<DscpPrioQueueDisc> qdisc, const std::string& spec)
+{
+    std::istringstream in(spec);
+    std::string entry;
+    while (std::getline(in, entry, ','))
+    {
+        std::vector<std::string> f;
+        std::istringstream fields(entry);
+        std::string field;
+        while (std::getline(fields, field, ':'))
+        {
+            f.push_back(field);
+        }
+        NS_ABORT_MSG_IF(f.size() != 6, "Contract: expected class:mode:CIR:CBS:PIR:PBS, got '" << entry << "'");
+        uint32_t cls = qdisc->GetClassByName(f[0]);
+        NS_ABORT_MSG_IF(cls == qdisc->GetNClasses(), "Contract: unknown class '" << f[0] << "'");
+        NS_ABORT_MSG_IF(f[1] != "police" && f[1] != "shape", "Contract: mode must be police or shape, got '" << f[1] << "'");
+        qdisc->SetClassContract(cls, f[1] == "police" ? DscpPrioQueueDisc::POLICE : DscpPrioQueueDisc::SHAPE,
+                                DataRate(f[2]).GetBitRate(), std::stoul(f[3]),
+                                DataRate(f[4]).GetBitRate(), std::stoul(f[5]));
+    }
+}
+
+// --- Q2: Function to Configure and Install the DSCP Scheduler ---
+// Network control and EF are strict priority; video, assured forwarding, best
+// effort and scavenger share the rest by DRR weight. Install it on both ends of a
+// link to prioritise both directions. Unlisted DSCPs fall into best effort, which
+// cfg.aqm can put behind flow-queued CoDel ("codel") or CoDel with ECN ("ecn").
+// cfg.contracts polices or shapes classes to their CIR/PIR.
+Ptr<QueueDisc> InstallQoS(Ptr<NetDevice> device, const QosConfig& cfg)
+{
+    NS_ABORT_MSG_IF(cfg.aqm != "none" && cfg.aqm != "codel" && cfg.aqm != "ecn",
+                    "Unknown --aqm mode " << cfg.aqm << " (none, codel, ecn)");
     TrafficControlHelper tcHelper;
 
-    // Use SetRootQueueDisc and configure via Attributes
-    tcHelper.SetRootQueueDisc("ns3::PfifoFastQueueDisc",
-                              "Bands", UintegerValue(3)); 
-    
-    // Install the queue disc on the device's output queue (TX side)
-    tcHelper.Install(device);
-    NS_LOG_INFO("QoS: PfifoFast installed on device " << device->GetNode()->GetId() << ":" << device->GetIfIndex());
+    // Replace the default root queue disc installed when the address was assigned
+    tcHelper.Uninstall(device);
+
+    Ptr<DscpPrioQueueDisc> qdisc = CreateObject<DscpPrioQueueDisc>();
+    uint32_t network = qdisc->AddClass("network", true, 0, 15000);
+    uint32_t ef = qdisc->AddClass("ef", true, 0, 30000);
+    uint32_t video = qdisc->AddClass("video", false, 4500, 90000);
+    uint32_t assured = qdisc->AddClass("assured", false, 3000, 90000);
+    uint32_t bestEffort = qdisc->AddClass("be", false, 1500, 150000);
+    uint32_t scavenger = qdisc->AddClass("scavenger", false, 300, 30000);
+
+    qdisc->SetDefaultClass(bestEffort);
+    qdisc->MapDscp(48, network);                    // CS6
+    qdisc->MapDscp(56, network);                    // CS7
+    qdisc->MapDscp(46, ef);                         // EF
+    qdisc->MapDscp(44, ef);                         // VOICE-ADMIT
+    qdisc->MapDscp(40, ef);                         // CS5
+    qdisc->MapDscp(32, video);                      // CS4
+    for (uint8_t drop = 1; drop <= 3; ++drop)
+    {
+        qdisc->MapDscp(32 + 2 * drop, video);       // AF41-AF43
+        qdisc->MapDscp(24 + 2 * drop, assured);     // AF31-AF33
+        qdisc->MapDscp(16 + 2 * drop, assured);     // AF21-AF23
+        qdisc->MapDscp(8 + 2 * drop, assured);      // AF11-AF13
+    }
+    qdisc->MapDscp(24, assured);                    // CS3
+    qdisc->MapDscp(16, assured);                    // CS2
+    qdisc->MapDscp(8, scavenger);                   // CS1
+
+    if (cfg.aqm != "none") {
+        Ptr<FlowCodelQueueDisc> aqm = CreateObject<FlowCodelQueueDisc>();
+        aqm->SetLimit(cfg.aqmLimit);
+        aqm->SetTarget(Seconds(cfg.aqmTarget));
+        aqm->SetInterval(Seconds(cfg.aqmInterval));
+        aqm->SetUseEcn(cfg.aqm == "ecn");
+        qdisc->SetClassQueueDisc(bestEffort, aqm);
+    }
+    ApplyClassContracts(qdisc, cfg.contracts);
+
+    device->GetNode()->GetObject<TrafficControlLayer>()->SetRootQueueDiscOnDevice(device, qdisc);
+    NS_LOG_INFO("QoS: DSCP priority/DRR scheduler installed on device " << device->GetNode()->GetId() << ":" << device->GetIfIndex());
+    return qdisc;
 }
 
 // --- Metrics Collection using FlowMonitor ---
-// FIX: The FlowMonitorHelper object (flowHelper) must be passed to retrieve the classifier
-void CheckMetrics(Ptr<FlowMonitor> fm, FlowMonitorHelper* flowHelper) 
+
+// Totals of one reporting class over all of its flows
+struct QosClassStats
 {
-    std::cout << "\n--- Q3: QoS Performance Verification ---\n";
+    std::string name;
+    uint64_t txPackets = 0;
+    uint64_t rxPackets = 0;
+    uint64_t rxBytes = 0;
+    double delaySum = 0;                // Seconds
+    double jitterSum = 0;
+    uint64_t jitterSamples = 0;         // One per received packet after each flow's first
+    Time firstRx = Time::Max();
+    Time lastRx = Time::Min();
+    std::vector<uint64_t> delayBins;    // Merged FlowMonitor delay histograms
+    double binWidth = 0;
 
-    double totalTxVoIP = 0, totalRxVoIP = 0, totalDelayVoIP = 0, totalJitterVoIP = 0;
-    double totalTxFTP = 0, totalRxFTP = 0, totalDelayFTP = 0;
+    double LossPct() const { return txPackets ? (txPackets - rxPackets) * 100.0 / txPackets : 0.0; }
+    double AvgDelayMs() const { return rxPackets ? delaySum / rxPackets * 1000.0 : 0.0; }
+    double AvgJitterMs() const { return jitterSamples ? jitterSum / jitterSamples * 1000.0 : 0.0; }
 
-    // FIX: Retrieve the classifier directly from the FlowMonitorHelper object.
-    Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowHelper->GetClassifier());
-    
-    std::map<FlowId, FlowMonitor::FlowStats> stats = fm->GetFlowStats();
+    // Goodput over the class's actual receive window
+    double ThroughputMbps() const {
+        return lastRx > firstRx ? rxBytes * 8.0 / (lastRx - firstRx).GetSeconds() / 1000000.0 : 0.0;
+    }
+
+    // Upper edge of the histogram bin holding the p-th quantile (conservative for tails)
+    double DelayPercentileMs(double p) const {
+        uint64_t total = 0;
+        for (uint64_t count : delayBins) {
+            total += count;
+        }
+        if (total == 0) {
+            return 0.0;
+        }
+        uint64_t target = static_cast<uint64_t>(std::ceil(p * total));
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < delayBins.size(); ++i)
+        {
+            seen += delayBins[i];
+            if (seen >= std::max<uint64_t>(target, 1)) {
+                return (i + 1) * binWidth * 1000.0;
+            }
+        }
+        return delayBins.size() * binWidth * 1000.0;
+    }
+
+    // Sums the totals each partition counted for its own flow ends
+    void MergePartitions()
+    {
+        uint64_t counts[5] = {txPackets, rxPackets, rxBytes, jitterSamples, delayBins.size()};
+        double sums[2] = {delaySum, jitterSum};
+        int64_t first = firstRx.GetTimeStep(), last = lastRx.GetTimeStep();
+        PartitionReduce(counts, 4, PARTITION_SUM);
+        PartitionReduce(counts + 4, 1, PARTITION_MAX);
+        PartitionReduce(sums, 2, PARTITION_SUM);
+        PartitionReduce(&first, 1, PARTITION_MIN);
+        PartitionReduce(&last, 1, PARTITION_MAX);
+        PartitionReduce(&binWidth, 1, PARTITION_MAX);
+        delayBins.resize(counts[4], 0);
+        PartitionReduce(delayBins.data(), delayBins.size(), PARTITION_SUM);
+        txPackets = counts[0];
+        rxPackets = counts[1];
+        rxBytes = counts[2];
+        jitterSamples = counts[3];
+        delaySum = sums[0];
+        jitterSum = sums[1];
+        firstRx = Time(first);
+        lastRx = Time(last);
+    }
+};
+
+// Sorts FlowMonitor flows into reporting classes by DSCP and/or destination port
+// rules (first match wins) and sums them in one pass over the stats map, which is
+// walked by const reference. A flow's class is resolved once and cached by FlowId,
+// so repeated aggregation only pays the classifier lookups for new flows. DSCP-only
+// rules use GetDscpCounts (a map lookup); port rules need FindFlow, which is a
+// linear scan in Ipv4FlowClassifier, so they are only consulted when required.
+//
+// A distributed run cannot use FlowMonitor: it only counts a received packet it
+// saw being sent, and a flow's source and sink are simulated by different
+// partitions. The classes are then fed from the sender Tx and sink
+// RxWithSeqTsSize traces instead (ConnectSender / ConnectSink, the sources must
+// send SeqTsSize headers), each partition counting its own ends, and
+// MergePartitions() sums them. Bytes are then application bytes, not IP bytes.
+class QosFlowAggregator
+{
+public:
+    static constexpr uint8_t NO_CLASS = 0xff;
+    static constexpr int16_t ANY_DSCP = -1;
+
+    uint32_t AddClass(const std::string& name)
+    {
+        QosClassStats stats;
+        stats.name = name;
+        m_classes.push_back(stats);
+        return m_classes.size() - 1;
+    }
+
+    void AddRule(uint32_t cls, int16_t dscp, uint16_t dstPortMin = 0, uint16_t dstPortMax = 65535)
+    {
+        Rule rule;
+        rule.cls = cls;
+        rule.dscp = dscp;
+        rule.dstPortMin = dstPortMin;
+        rule.dstPortMax = dstPortMax;
+        m_rules.push_back(rule);
+    }
+
+    const QosClassStats& GetClass(uint32_t cls) const { return m_classes[cls]; }
+
+    void ConnectSender(Ptr<Application> app, uint32_t cls)
+    {
+        app->TraceConnectWithoutContext("Tx", MakeBoundCallback(&QosFlowAggregator::TxTrace, this, cls));
+    }
+
+    void ConnectSink(Ptr<Application> app, uint32_t cls, double binWidth)
+    {
+        m_classes[cls].binWidth = binWidth;
+        app->TraceConnectWithoutContext("RxWithSeqTsSize", MakeBoundCallback(&QosFlowAggregator::RxTrace, this, cls));
+    }
+
+    void MergePartitions()
+    {
+        for (QosClassStats& c : m_classes)
+        {
+            c.MergePartitions();
+        }
+    }
 
-    for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin(); i != stats.end(); ++i)
+    // Later aggregates only count what the flows do after now (warm-started runs
+    // measure from the end of the shared warm-up)
+    void SetBaseline(Ptr<FlowMonitor> fm)
     {
-        Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(i->first);
+        fm->CheckForLostPackets();
+        m_baseline = fm->GetFlowStats();
+        m_baselineTime = Simulator::Now();
+    }
 
-        // Classify the flows based on the source port (9=VoIP, 10=FTP)
-        if (t.sourcePort == 9) // VoIP Flow
+    void Aggregate(Ptr<FlowMonitor> fm, Ptr<Ipv4FlowClassifier> classifier)
+    {
+        for (QosClassStats& c : m_classes)
         {
-            totalTxVoIP += i->second.txPackets;
-            totalRxVoIP += i->second.rxPackets;
-            totalDelayVoIP += i->second.delaySum.GetSeconds();
-            totalJitterVoIP += i->second.jitterSum.GetSeconds();
+            c.txPackets = c.rxPackets = c.rxBytes = c.jitterSamples = 0;
+            c.delaySum = c.jitterSum = 0;
+            c.firstRx = Time::Max();
+            c.lastRx = Time::Min();
+            std::fill(c.delayBins.begin(), c.delayBins.end(), 0);
         }
-        else if (t.sourcePort == 10) // FTP Flow
+
+        const FlowMonitor::FlowStatsContainer& stats = fm->GetFlowStats();
+        for (FlowMonitor::FlowStatsContainer::const_iterator i = stats.begin(); i != stats.end(); ++i)
         {
-            totalTxFTP += i->second.txPackets;
-            totalRxFTP += i->second.rxPackets;
-            totalDelayFTP += i->second.delaySum.GetSeconds();
+            uint8_t cls = ClassOf(i->first, classifier);
+            if (cls == NO_CLASS) {
+                continue;
+            }
+            const FlowMonitor::FlowStats& flow = i->second;
+            FlowMonitor::FlowStatsContainer::const_iterator base = m_baseline.find(i->first);
+            const FlowMonitor::FlowStats* before = base == m_baseline.end() ? 0 : &base->second;
+            QosClassStats& c = m_classes[cls];
+            c.txPackets += flow.txPackets - (before ? before->txPackets : 0);
+            c.rxPackets += flow.rxPackets - (before ? before->rxPackets : 0);
+            c.rxBytes += flow.rxBytes - (before ? before->rxBytes : 0);
+            c.delaySum += (flow.delaySum - (before ? before->delaySum : Time(0))).GetSeconds();
+            c.jitterSum += (flow.jitterSum - (before ? before->jitterSum : Time(0))).GetSeconds();
+            if (flow.rxPackets > (before ? before->rxPackets : 0)) {
+                // FlowMonitor takes no jitter sample on a flow's first packet
+                bool receiving = before && before->rxPackets > 0;
+                c.jitterSamples += flow.rxPackets - (before ? before->rxPackets : 0) - (receiving ? 0 : 1);
+                // A flow already receiving at the baseline is measured from the baseline on
+                c.firstRx = std::min(c.firstRx, receiving ? m_baselineTime : flow.timeFirstRxPacket);
+                c.lastRx = std::max(c.lastRx, flow.timeLastRxPacket);
+            }
+
+            const Histogram& h = flow.delayHistogram;
+            if (h.GetNBins() > c.delayBins.size()) {
+                c.delayBins.resize(h.GetNBins(), 0);
+            }
+            for (uint32_t b = 0; b < h.GetNBins(); ++b)
+            {
+                uint32_t earlier = before && b < before->delayHistogram.GetNBins() ? before->delayHistogram.GetBinCount(b) : 0;
+                c.delayBins[b] += h.GetBinCount(b) - earlier;
+            }
+            if (h.GetNBins() > 0) {
+                c.binWidth = h.GetBinWidth(0);
+            }
         }
     }
 
-    // --- Metrics for VoIP (High Priority - DSCP EF) ---
-    if (totalRxVoIP > 0)
+private:
+    static void TxTrace(QosFlowAggregator* aggregator, uint32_t cls, Ptr<const Packet>)
+    {
+        ++aggregator->m_classes[cls].txPackets;
+    }
+
+    // Same delay, jitter and histogram accounting as FlowMonitor, per sending socket
+    static void RxTrace(QosFlowAggregator* aggregator, uint32_t cls, Ptr<const Packet>,
+                        const Address& from, const Address&, const SeqTsSizeHeader& header)
+    {
+        QosClassStats& c = aggregator->m_classes[cls];
+        Time now = Simulator::Now();
+        Time delay = now - header.GetTs();
+        ++c.rxPackets;
+        c.rxBytes += header.GetSize();
+        c.delaySum += delay.GetSeconds();
+        c.firstRx = std::min(c.firstRx, now);
+        c.lastRx = std::max(c.lastRx, now);
+
+        InetSocketAddress sender = InetSocketAddress::ConvertFrom(from);
+        uint64_t key = static_cast<uint64_t>(sender.GetIpv4().Get()) << 16 | sender.GetPort();
+        std::unordered_map<uint64_t, Time>::iterator last = aggregator->m_lastDelay.find(key);
+        if (last != aggregator->m_lastDelay.end()) {
+            c.jitterSum += std::abs((delay - last->second).GetSeconds());
+            ++c.jitterSamples;
+        }
+        aggregator->m_lastDelay[key] = delay;
+
+        uint32_t bin = static_cast<uint32_t>(delay.GetSeconds() / c.binWidth);
+        if (bin >= c.delayBins.size()) {
+            c.delayBins.resize(bin + 1, 0);
+        }
+        ++c.delayBins[bin];
+    }
+
+    struct Rule
+    {
+        uint32_t cls;
+        int16_t dscp;
+        uint16_t dstPortMin;
+        uint16_t dstPortMax;
+    };
+
+    static constexpr uint8_t UNRESOLVED = 0xfe;
+
+    uint8_t ClassOf(FlowId id, Ptr<Ipv4FlowClassifier> classifier)
+    {
+        if (id >= m_flowClass.size()) {
+            m_flowClass.resize(std::max<size_t>(id + 1, m_flowClass.size() * 2), UNRESOLVED);
+        }
+        if (m_flowClass[id] != UNRESOLVED) {
+            return m_flowClass[id];
+        }
+
+        // Dominant DSCP of the flow (the counts come sorted by packet count)
+        int16_t dscp = ANY_DSCP;
+        std::vector<std::pair<Ipv4Header::DscpType, uint32_t> > dscps = classifier->GetDscpCounts(id);
+        if (!dscps.empty()) {
+            dscp = dscps[0].first;
+        }
+
+        bool haveTuple = false;
+        Ipv4FlowClassifier::FiveTuple tuple;
+        uint8_t cls = NO_CLASS;
+        for (const Rule& rule : m_rules)
+        {
+            if (rule.dscp != ANY_DSCP && rule.dscp != dscp) {
+                continue;
+            }
+            if (rule.dstPortMin != 0 || rule.dstPortMax != 65535) {
+                if (!haveTuple) {
+                    tuple = classifier->FindFlow(id);
+                    haveTuple = true;
+                }
+                if (tuple.destinationPort < rule.dstPortMin || tuple.destinationPort > rule.dstPortMax) {
+                    continue;
+                }
+            }
+            cls = rule.cls;
+            break;
+        }
+        m_flowClass[id] = cls;
+        return cls;
+    }
+
+    std::vector<QosClassStats> m_classes;
+    std::vector<Rule> m_rules;
+    std::vector<uint8_t> m_flowClass;   // FlowId -> class, UNRESOLVED until first seen
+    FlowMonitor::FlowStatsContainer m_baseline;     // Empty = count from the start
+    Time m_baselineTime;
+    std::unordered_map<uint64_t, Time> m_lastDelay;  // Trace-fed: sender address and port -> last delay
+};
+
+// Reporting classes used by CheckMetrics
+const uint32_t QOS_CLASS_VOIP = 0;
+const uint32_t QOS_CLASS_FTP = 1;
+
+void FillClassResult(const QosClassStats& c, QosClassResult& r)
+{
+    r.txPackets = c.txPackets;
+    r.rxPackets = c.rxPackets;
+    r.lossPct = c.LossPct();
+    r.delayMs = c.AvgDelayMs();
+    r.jitterMs = c.AvgJitterMs();
+    r.throughputMbps = c.ThroughputMbps();
+    r.p50DelayMs = c.DelayPercentileMs(0.50);
+    r.p99DelayMs = c.DelayPercentileMs(0.99);
+    r.p999DelayMs = c.DelayPercentileMs(0.999);
+}
+
+// =================================================================
+// Time-Series Sampler
+// =================================================================
+
+// Per-class counters for the current sampling interval, fed by trace sources
+struct QosIntervalCounters
+{
+    uint32_t txPackets = 0;
+    uint32_t rxPackets = 0;
+    uint64_t rxBytes = 0;
+    uint32_t drops = 0;
+    double delaySum = 0;    // Seconds
+    double maxDelay = 0;
+};
+
+// Samples every class at a fixed interval. Counters are bumped by the sender Tx,
+// sink RxWithSeqTsSize and queue disc Drop traces as packets move, so a tick only
+// reads and resets them plus the queue depth: its cost does not depend on the
+// number of flows. Binary records are packed little-endian:
+//   double time, uint32 class, uint32 tx, uint32 rx, uint32 drops,
+//   double throughputMbps, double avgDelayMs, double maxDelayMs,
+//   uint32 queuePackets, uint32 queueBytes                      (56 bytes)
+class QosTimeSeriesSampler
+{
+public:
+    static constexpr uint8_t NO_CLASS = 0xff;
+
+    explicit QosTimeSeriesSampler(uint32_t nClasses)
+    : m_counters(nClasses), m_binary(false)
+    {
+        std::fill(m_dscpClass, m_dscpClass + 64, NO_CLASS);
+    }
+
+    void SetClassName(uint32_t cls, const std::string& name)
+    {
+        if (m_names.size() <= cls) {
+            m_names.resize(cls + 1);
+        }
+        m_names[cls] = name;
+    }
+
+    // Queue disc drops are attributed to a class by the packet's DSCP
+    void MapDscp(uint8_t dscp, uint32_t cls) { m_dscpClass[dscp & 0x3f] = cls; }
+
+    void SetQueueDisc(Ptr<QueueDisc> qdisc)
+    {
+        m_qdisc = qdisc;
+        qdisc->TraceConnectWithoutContext("Drop", MakeBoundCallback(&QosTimeSeriesSampler::DropTrace, this));
+    }
+
+    void ConnectSender(Ptr<Application> app, uint32_t cls)
     {
-        double lossVoIP = (totalTxVoIP - totalRxVoIP) / totalTxVoIP * 100.0;
-        double avgDelayVoIP = totalDelayVoIP / totalRxVoIP * 1000.0;
-        double avgJitterVoIP = totalJitterVoIP / totalRxVoIP * 1000.0;
+        app->TraceConnectWithoutContext("Tx", MakeBoundCallback(&QosTimeSeriesSampler::TxTrace, this, cls));
+    }
 
+    void ConnectSink(Ptr<Application> app, uint32_t cls)
+    {
+        app->TraceConnectWithoutContext("RxWithSeqTsSize", MakeBoundCallback(&QosTimeSeriesSampler::RxTrace, this, cls));
+    }
+
+    void Start(const std::string& path, bool binary, Time interval)
+    {
+        m_binary = binary;
+        m_interval = interval;
+        m_writer.Open(path);
+        if (!m_binary) {
+            m_writer.Write("time,class,txPackets,rxPackets,drops,lossPct,throughputMbps,avgDelayMs,maxDelayMs,queuePackets,queueBytes\n");
+        }
+        Simulator::Schedule(m_interval, &QosTimeSeriesSampler::Sample, this);
+    }
+
+    void Stop() { m_writer.Close(); }
+
+    static void TxTrace(QosTimeSeriesSampler* sampler, uint32_t cls, Ptr<const Packet> p)
+    {
+        ++sampler->m_counters[cls].txPackets;
+    }
+
+    static void RxTrace(QosTimeSeriesSampler* sampler, uint32_t cls, Ptr<const Packet> p,
+                        const Address& from, const Address& to, const SeqTsSizeHeader& header)
+    {
+        QosIntervalCounters& c = sampler->m_counters[cls];
+        double delay = (Simulator::Now() - header.GetTs()).GetSeconds();
+        ++c.rxPackets;
+        c.rxBytes += header.GetSize();
+        c.delaySum += delay;
+        c.maxDelay = std::max(c.maxDelay, delay);
+    }
+
+    static void DropTrace(QosTimeSeriesSampler* sampler, Ptr<const QueueDiscItem> item)
+    {
+        Ptr<const Ipv4QueueDiscItem> ipItem = DynamicCast<const Ipv4QueueDiscItem>(item);
+        if (ipItem) {
+            uint8_t cls = sampler->m_dscpClass[ipItem->GetHeader().GetDscp() & 0x3f];
+            if (cls != NO_CLASS) {
+                ++sampler->m_counters[cls].drops;
+            }
+        }
+    }
+
+private:
+    void Sample()
+    {
+        double now = Simulator::Now().GetSeconds();
+        uint32_t queuePackets = m_qdisc ? m_qdisc->GetNPackets() : 0;
+        uint32_t queueBytes = m_qdisc ? m_qdisc->GetNBytes() : 0;
+        double interval = m_interval.GetSeconds();
+
+        for (uint32_t cls = 0; cls < m_counters.size(); ++cls)
+        {
+            QosIntervalCounters& c = m_counters[cls];
+            double throughput = c.rxBytes * 8.0 / interval / 1000000.0;
+            double avgDelayMs = c.rxPackets ? c.delaySum / c.rxPackets * 1000.0 : 0.0;
+            double maxDelayMs = c.maxDelay * 1000.0;
+
+            if (m_binary) {
+                char record[56];
+                char* out = record;
+                Pack(out, now);
+                Pack(out, cls);
+                Pack(out, c.txPackets);
+                Pack(out, c.rxPackets);
+                Pack(out, c.drops);
+                Pack(out, throughput);
+                Pack(out, avgDelayMs);
+                Pack(out, maxDelayMs);
+                Pack(out, queuePackets);
+                Pack(out, queueBytes);
+                m_writer.Write(record, sizeof(record));
+            } else {
+                char line[256];
+                int n = std::snprintf(line, sizeof(line), "%.6f,%s,%u,%u,%u,%.3f,%.6f,%.3f,%.3f,%u,%u\n",
+                                      now, cls < m_names.size() ? m_names[cls].c_str() : "",
+                                      c.txPackets, c.rxPackets, c.drops,
+                                      c.txPackets ? c.drops * 100.0 / c.txPackets : 0.0,
+                                      throughput, avgDelayMs, maxDelayMs, queuePackets, queueBytes);
+                m_writer.Write(line, std::min<size_t>(n, sizeof(line) - 1));
+            }
+            c = QosIntervalCounters();
+        }
+        Simulator::Schedule(m_interval, &QosTimeSeriesSampler::Sample, this);
+    }
+
+    template <typename T>
+    static void Pack(char*& out, T value)
+    {
+        // Host bytes, then least significant byte first whatever the host order
+        uint8_t bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        for (uint32_t i = 0; i < sizeof(T); ++i)
+        {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            out[i] = bytes[sizeof(T) - 1 - i];
+#else
+            out[i] = bytes[i];
+#endif
+        }
+        out += sizeof(T);
+    }
+
+    std::vector<QosIntervalCounters> m_counters;
+    std::vector<std::string> m_names;
+    uint8_t m_dscpClass[64];
+    Ptr<QueueDisc> m_qdisc;
+    Time m_interval;
+    bool m_binary;
+    BackgroundWriter m_writer;
+};
+
+// FIX: The FlowMonitorHelper object (flowHelper) must be passed to retrieve the classifier
+void CollectMetrics(Ptr<FlowMonitor> fm, FlowMonitorHelper* flowHelper, QosFlowAggregator* aggregator)
+{
+    // FIX: Retrieve the classifier directly from the FlowMonitorHelper object.
+    Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowHelper->GetClassifier());
+    aggregator->Aggregate(fm, classifier);
+}
+
+// Results and report from the collected classes; after the run, once they are merged
+void CheckMetrics(const QosFlowAggregator* aggregator, const QosConfig* cfg, const NodeQueueStats* queues,
+                  QosRunResult* result) 
+{
+    FillClassResult(aggregator->GetClass(QOS_CLASS_VOIP), result->voip);
+    FillClassResult(aggregator->GetClass(QOS_CLASS_FTP), result->ftp);
+
+    // Sweep replicas only report through the merged result table; partitions
+    // other than the first hold the same merged results
+    if (!cfg->verbose || cfg->systemId != 0) {
+        return;
+    }
+    std::cout << "\n--- Q3: QoS Performance Verification ---\n";
+
+    // --- Metrics for VoIP (High Priority - DSCP EF) ---
+    if (result->voip.rxPackets > 0)
+    {
         std::cout << "VoIP (High Priority / DSCP EF):\n";
-        std::cout << "  Packet Loss: " << std::fixed << std::setprecision(2) << lossVoIP << " % [Expected: Near 0%]\n";
-        std::cout << "  Avg Latency: " << std::fixed << std::setprecision(2) << avgDelayVoIP << " ms [Expected: Low]\n";
-        std::cout << "  Avg Jitter:  " << std::fixed << std::setprecision(2) << avgJitterVoIP << " ms [Expected: Low]\n";
+        std::cout << "  Packet Loss: " << std::fixed << std::setprecision(2) << result->voip.lossPct << " % [Expected: Near 0%]\n";
+        std::cout << "  Avg Latency: " << std::fixed << std::setprecision(2) << result->voip.delayMs << " ms [Expected: Low]\n";
+        std::cout << "  Avg Jitter:  " << std::fixed << std::setprecision(2) << result->voip.jitterMs << " ms [Expected: Low]\n";
+        std::cout << "  Latency p50/p99/p99.9: " << std::fixed << std::setprecision(2) << result->voip.p50DelayMs << " / "
+                  << result->voip.p99DelayMs << " / " << result->voip.p999DelayMs << " ms\n";
     }
 
     // --- Metrics for FTP (Low Priority - DSCP BE) ---
-    if (totalRxFTP > 0)
+    if (result->ftp.rxPackets > 0)
     {
-        double lossFTP = (totalTxFTP - totalRxFTP) / totalTxFTP * 100.0;
-        double throughputFTP = (totalRxFTP * 1500.0 * 8.0) / ((SIMULATION_TIME - 3.0) * 1000000.0);
-        double avgDelayFTP = totalDelayFTP / totalRxFTP * 1000.0;
-
         std::cout << "\nFTP (Low Priority / DSCP BE):\n";
-        std::cout << "  Packet Loss: " << std::fixed << std::setprecision(2) << lossFTP << " % [Expected: High]\n";
-        std::cout << "  Avg Latency: " << std::fixed << std::setprecision(2) << avgDelayFTP << " ms [Expected: High]\n";
-        std::cout << "  Throughput:  " << std::fixed << std::setprecision(2) << throughputFTP << " Mbps [Expected: Bottlenecked]\n";
+        std::cout << "  Packet Loss: " << std::fixed << std::setprecision(2) << result->ftp.lossPct << " % [Expected: High]\n";
+        std::cout << "  Avg Latency: " << std::fixed << std::setprecision(2) << result->ftp.delayMs << " ms [Expected: High]\n";
+        std::cout << "  Latency p50/p99/p99.9: " << std::fixed << std::setprecision(2) << result->ftp.p50DelayMs << " / "
+                  << result->ftp.p99DelayMs << " / " << result->ftp.p999DelayMs << " ms\n";
+        std::cout << "  Throughput:  " << std::fixed << std::setprecision(2) << result->ftp.throughputMbps << " Mbps [Expected: Bottlenecked]\n";
     }
+
+    std::cout << "\nBottleneck queue discs:\n";
+    queues->Print(std::cout);
 }
 
-int main(int argc, char *argv[])
+// --- One complete simulation of the scenario (Q1-Q4) ---
+QosRunResult RunQosScenario(const QosConfig& cfg, QosWarmStart* warmStart = 0)
 {
+    QosRunResult result;
+    RngSeedManager::SetRun(cfg.run);
+
     // Setup logging
-    LogComponentEnable("QoSImplementation", LOG_LEVEL_INFO);
-    LogComponentEnable("OnOffApplication", LOG_LEVEL_INFO);
-    LogComponentEnable("PfifoFastQueueDisc", LOG_LEVEL_INFO);
-    
-    // 1. Create Nodes (n0, n1, n2)
-    NodeContainer nodes;
-    nodes.Create(3);
-    Ptr<Node> n0 = nodes.Get(0); 
-    Ptr<Node> n2 = nodes.Get(2); // Destination
-
-    // 2. Setup Links (Triangular Mesh)
-    PointToPointHelper p2p;
-    p2p.SetQueue("ns3::DropTailQueue", "MaxPackets", UintegerValue(100)); // Base Queue
-
-    // Link 1 (HQ <-> Branch)
-    p2p.SetDeviceAttribute("DataRate", StringValue("100Mbps"));
-    p2p.SetChannelAttribute("Delay", StringValue("1ms"));
-    NodeContainer link1Nodes(n0, nodes.Get(1));
-    NetDeviceContainer link1Devices = p2p.Install(link1Nodes);
-
-    // Link 2 (Branch <-> DC)
-    NodeContainer link2Nodes(nodes.Get(1), n2);
-    NetDeviceContainer link2Devices = p2p.Install(link2Nodes);
-
-    // Link 3 (HQ <-> DC) - THE BOTTLENECK LINK (Q4)
-    p2p.SetDeviceAttribute("DataRate", StringValue(LINK_DATA_RATE)); 
-    p2p.SetChannelAttribute("Delay", StringValue("10ms")); // High delay for congestion
-    NodeContainer link3Nodes(n0, n2);
-    NetDeviceContainer bottleneckDevices = p2p.Install(link3Nodes);
-
-    // 3. Install Internet Stack
-    InternetStackHelper stack;
-    stack.Install(nodes);
+    if (cfg.verbose) {
+        LogComponentEnable("QoSImplementation", LOG_LEVEL_INFO);
+        LogComponentEnable("OnOffApplication", LOG_LEVEL_INFO);
+    }
     
-    Ipv4AddressHelper address;
-    address.SetBase("10.1.1.0", "255.255.255.0"); address.Assign(link1Devices);
-    address.SetBase("10.1.2.0", "255.255.255.0"); address.Assign(link2Devices);
-    address.SetBase("10.1.3.0", "255.255.255.0"); 
-    Ipv4InterfaceContainer interfaces3 = address.Assign(bottleneckDevices);
+    // 1-3. Nodes, links (Triangular Mesh), Internet stack, addresses and the
+    // static route that forces traffic through the bottleneck
+    WanTopology topo;
+    topo.SetPartitioning(cfg.systems, cfg.systemId);
+    if (cfg.topologyFile.empty()) {
+        topo.LoadString(QosTopology(cfg));
+    } else {
+        NS_ABORT_MSG_IF(cfg.sites > 0, "--sites only extends the built-in topology");
+        topo.LoadFile(cfg.topologyFile);
+    }
+    Ptr<Node> n0 = topo.GetNode("n0"); 
+    Ptr<Node> n2 = topo.GetNode("n2"); // Destination
 
-    // 4. Q2: Install QoS on the Bottleneck Link (HQ side - n0)
-    InstallQoS(bottleneckDevices.Get(0));
+    // Traffic sources: HQ itself, or every branch site behind it. Applications
+    // only go on the sources and sink this partition simulates.
+    bool distributed = cfg.systems > 1;
+    NodeContainer sources, localSources;
+    for (uint32_t i = 1; i <= cfg.sites; ++i)
+    {
+        sources.Add(topo.GetNode("s" + std::to_string(i)));
+    }
+    if (cfg.sites == 0) {
+        sources.Add(n0);
+    }
+    for (uint32_t i = 0; i < sources.GetN(); ++i)
+    {
+        if (topo.IsLocal(sources.Get(i))) {
+            localSources.Add(sources.Get(i));
+        }
+    }
+
+    // 4. Q2: Install QoS on both ends of the Bottleneck Link (HQ side n0 is the congested one)
+    Ptr<QueueDisc> bottleneckQdisc = InstallQoS(topo.GetDevice("n0", "bottleneck"), cfg);
+    NodeQueueStats bottleneckQueues;
+    bottleneckQueues.Install(bottleneckQdisc, "n0 bottleneck");
+    bottleneckQueues.Install(InstallQoS(topo.GetDevice("n2", "bottleneck"), cfg), "n2 bottleneck");
 
-    // 5. Setup Static Routing (Forces traffic through the bottleneck)
+    // 5. Global routing for everything the static route does not cover
     Ipv4GlobalRoutingHelper::PopulateRoutingTables(); 
-    
-    // Correct call to GetRouting<T> 
-    Ptr<Ipv4StaticRouting> n0Routing = Ipv4GlobalRoutingHelper::GetRouting<Ipv4StaticRouting>(n0->GetObject<Ipv4>()->GetObject<Ipv4RoutingProtocol>());
-    
-    // Add a route on n0: to reach 10.1.2.0/24 (via DC, next-hop 10.1.3.2)
-    n0Routing->AddNetworkRouteTo(Ipv4Address("10.1.2.0"), Ipv4Mask("255.255.255.0"), 
-                                 interfaces3.GetAddress(1), 3, 0); 
 
     // 6. Application Setup (VoIP/FTP)
-    Ipv4Address sinkAddress = interfaces3.GetAddress(1); // 10.1.3.2 (DC's direct link IP)
+    Ipv4Address sinkAddress = topo.GetAddress("n2", "bottleneck"); // 10.1.3.2 (DC's direct link IP)
     uint16_t voipPort = 9;
     uint16_t ftpPort = 10;
+    uint16_t videoPort = 11;
+    uint16_t tracePort = 12;
+    bool timeSeries = !cfg.timeSeriesFile.empty();
+    bool seqTs = timeSeries || distributed;     // Both need send timestamps carried in SeqTsSize headers
     
-    PacketSinkHelper sink("ns3::UdpSocketFactory", InetSocketAddress(sinkAddress, voipPort));
-    sink.SetAttribute("Protocol", TypeIdValue(UdpSocketFactory::GetTypeId()));
-    sink.Install(n2).Start(Seconds(0.0));
-    
-    PacketSinkHelper sink2("ns3::UdpSocketFactory", InetSocketAddress(sinkAddress, ftpPort));
-    sink2.SetAttribute("Protocol", TypeIdValue(UdpSocketFactory::GetTypeId()));
-    sink2.Install(n2).Start(Seconds(0.0));
-
-    // A. VoIP Traffic (High Priority - DSCP EF)
-    OnOffHelper voipApp("ns3::UdpSocketFactory", InetSocketAddress(sinkAddress, voipPort));
-    voipApp.SetAttribute("PacketSize", UintegerValue(200)); 
-    voipApp.SetAttribute("DataRate", StringValue("2Mbps")); 
-    voipApp.SetAttribute("ToS", UintegerValue(0x2e << 2)); // DSCP EF (101110)
-    ApplicationContainer voipApps = voipApp.Install(n0);
+    bool models = cfg.traffic == "models";
+    NS_ABORT_MSG_IF(!models && cfg.traffic != "onoff" && cfg.traffic != "trace", "Unknown --traffic '" << cfg.traffic << "'");
+
+    // UDP sinks only count (no per-packet copies); bulk transfers need a TCP PacketSink
+    ApplicationContainer voipSinks, ftpSinks;
+    if (topo.IsLocal(n2)) {
+        voipSinks = UdpCountSink::Install(n2, InetSocketAddress(sinkAddress, voipPort), seqTs);
+        if (models) {
+            PacketSinkHelper sink2("ns3::TcpSocketFactory", InetSocketAddress(sinkAddress, ftpPort));
+            sink2.SetAttribute("EnableSeqTsSizeHeader", BooleanValue(seqTs));
+            ftpSinks = sink2.Install(n2);
+        } else {
+            ftpSinks = UdpCountSink::Install(n2, InetSocketAddress(sinkAddress, ftpPort), seqTs);
+        }
+    }
+    voipSinks.Start(Seconds(0.0));
+    ftpSinks.Start(Seconds(0.0));
+
+    ApplicationContainer voipApps, ftpApps;
+    if (cfg.traffic == "onoff") {
+        // A. VoIP Traffic (High Priority - DSCP EF)
+        OnOffHelper voipApp("ns3::UdpSocketFactory", InetSocketAddress(sinkAddress, voipPort));
+        voipApp.SetAttribute("PacketSize", UintegerValue(cfg.voipPacketSize)); 
+        voipApp.SetAttribute("DataRate", StringValue(cfg.voipRate)); 
+        voipApp.SetAttribute("ToS", UintegerValue(0x2e << 2)); // DSCP EF (101110)
+        voipApp.SetAttribute("EnableSeqTsSizeHeader", BooleanValue(seqTs));
+        voipApps = voipApp.Install(localSources);
+        
+        // B. FTP Traffic (Low Priority - DSCP BE) - CONGESTION CAUSE
+        OnOffHelper ftpApp("ns3::UdpSocketFactory", InetSocketAddress(sinkAddress, ftpPort));
+        ftpApp.SetAttribute("PacketSize", UintegerValue(cfg.ftpPacketSize));
+        ftpApp.SetAttribute("DataRate", StringValue(cfg.ftpRate)); 
+        ftpApp.SetAttribute("ToS", UintegerValue(0x00)); // DSCP BE (000000)
+        ftpApp.SetAttribute("EnableSeqTsSizeHeader", BooleanValue(seqTs));
+        ftpApps = ftpApp.Install(localSources);
+    } else {
+        // One generator per reporting class and source, each starting all of its
+        // flows in one batch; flows are dealt round-robin over the sources, and
+        // those dealt to another partition's sources are left to it
+        std::vector<Ptr<TrafficGenerator> > voipGens(sources.GetN()), ftpGens(sources.GetN());
+        for (uint32_t i = 0; i < sources.GetN(); ++i)
+        {
+            if (!topo.IsLocal(sources.Get(i))) {
+                continue;
+            }
+            Ptr<TrafficGenerator> voipGen = CreateObject<TrafficGenerator>();
+            Ptr<TrafficGenerator> ftpGen = CreateObject<TrafficGenerator>();
+            voipGen->SetAttribute("EnableSeqTsSizeHeader", BooleanValue(seqTs));
+            ftpGen->SetAttribute("EnableSeqTsSizeHeader", BooleanValue(seqTs));
+            sources.Get(i)->AddApplication(voipGen);
+            sources.Get(i)->AddApplication(ftpGen);
+            voipApps.Add(voipGen);
+            ftpApps.Add(ftpGen);
+            voipGens[i] = voipGen;
+            ftpGens[i] = ftpGen;
+        }
+        auto deal = [](std::vector<Ptr<TrafficGenerator> >& gens, uint32_t flows, const TrafficFlowSpec& spec) {
+            for (uint32_t i = 0; i < flows; ++i)
+            {
+                if (gens[i % gens.size()]) {
+                    gens[i % gens.size()]->AddFlow(spec);
+                }
+            }
+        };
+
+        TrafficFlowSpec spec;
+        spec.stop = Seconds(cfg.simTime - 3.0);
+        if (models) {
+            spec.model = TrafficModel::VOIP;
+            spec.remote = InetSocketAddress(sinkAddress, voipPort);
+            spec.dscp = 0x2e;
+            spec.packetSize = cfg.voipPacketSize;
+            deal(voipGens, cfg.voipFlows, spec);
+
+            spec.model = TrafficModel::BULK;
+            spec.remote = InetSocketAddress(sinkAddress, ftpPort);
+            spec.dscp = 0x00;
+            spec.packetSize = cfg.ftpPacketSize;
+            deal(ftpGens, cfg.ftpFlows, spec);
+
+            // Video only adds load to the AF4x class
+            spec.model = TrafficModel::VIDEO;
+            spec.remote = InetSocketAddress(sinkAddress, videoPort);
+            spec.dscp = 0x22;
+            spec.packetSize = 1400;
+            spec.rate = DataRate(cfg.videoRate);
+            deal(ftpGens, cfg.videoFlows, spec);
+        } else {
+            // Replayed flows carry their own DSCP; FlowMonitor sorts them into classes,
+            // the time series counts all of their sends as FTP
+            NS_ABORT_MSG_IF(cfg.trafficTrace.empty(), "--traffic=trace needs --trafficTrace");
+            spec.model = TrafficModel::TRACE;
+            spec.remote = InetSocketAddress(sinkAddress, tracePort);
+            spec.trace = std::make_shared<TrafficTrace>(cfg.trafficTrace);
+            deal(ftpGens, cfg.traceFlows, spec);
+        }
+        if ((cfg.videoFlows > 0 || !models) && topo.IsLocal(n2)) {
+            UdpCountSink::Install(n2, InetSocketAddress(sinkAddress, models ? videoPort : tracePort)).Start(Seconds(0.0));
+        }
+    }
     voipApps.Start(Seconds(1.0));
-    
-    // B. FTP Traffic (Low Priority - DSCP BE) - CONGESTION CAUSE
-    OnOffHelper ftpApp("ns3::UdpSocketFactory", InetSocketAddress(sinkAddress, ftpPort));
-    ftpApp.SetAttribute("PacketSize", UintegerValue(1500));
-    ftpApp.SetAttribute("DataRate", StringValue("4Mbps")); 
-    ftpApp.SetAttribute("ToS", UintegerValue(0x00)); // DSCP BE (000000)
-    ApplicationContainer ftpApps = ftpApp.Install(n0);
     ftpApps.Start(Seconds(1.0));
 
     // FINAL FIX: Use SetStopTime on the specific application to schedule its termination.
     // This is the public method to control the running time of an application.
-    voipApps.Get(0)->SetStopTime(Seconds(SIMULATION_TIME - 3.0));
-    ftpApps.Get(0)->SetStopTime(Seconds(SIMULATION_TIME - 3.0));
+    voipApps.Stop(Seconds(cfg.simTime - 3.0));
+    ftpApps.Stop(Seconds(cfg.simTime - 3.0));
 
     // 7. Q3: Flow Monitor Setup
     Ptr<FlowMonitor> flowMonitor;
     FlowMonitorHelper flowHelper;
-    flowMonitor = flowHelper.InstallAll();
+    flowHelper.SetMonitorAttribute("DelayBinWidth", DoubleValue(cfg.delayBinWidth));
+    if (!distributed) {
+        flowMonitor = flowHelper.InstallAll();
+    }
+
+    // Per-class aggregation rules: VoIP by DSCP EF, FTP by DSCP BE; a distributed
+    // run feeds the classes from the applications of this partition instead
+    QosFlowAggregator aggregator;
+    aggregator.AddClass("voip");
+    aggregator.AddClass("ftp");
+    aggregator.AddRule(QOS_CLASS_VOIP, 0x2e);
+    aggregator.AddRule(QOS_CLASS_FTP, 0x00);
+    for (uint32_t i = 0; distributed && i < voipApps.GetN(); ++i)
+    {
+        aggregator.ConnectSender(voipApps.Get(i), QOS_CLASS_VOIP);
+        aggregator.ConnectSender(ftpApps.Get(i), QOS_CLASS_FTP);
+    }
+    for (uint32_t i = 0; distributed && i < voipSinks.GetN(); ++i)
+    {
+        aggregator.ConnectSink(voipSinks.Get(i), QOS_CLASS_VOIP, cfg.delayBinWidth);
+        aggregator.ConnectSink(ftpSinks.Get(i), QOS_CLASS_FTP, cfg.delayBinWidth);
+    }
     
+    // Time series of the same classes, fed incrementally by trace sources
+    QosTimeSeriesSampler sampler(2);
+    if (timeSeries) {
+        sampler.SetClassName(QOS_CLASS_VOIP, "voip");
+        sampler.SetClassName(QOS_CLASS_FTP, "ftp");
+        sampler.MapDscp(0x2e, QOS_CLASS_VOIP);
+        sampler.MapDscp(0x00, QOS_CLASS_FTP);
+        sampler.SetQueueDisc(bottleneckQdisc);
+        for (uint32_t i = 0; i < voipApps.GetN(); ++i)
+        {
+            sampler.ConnectSender(voipApps.Get(i), QOS_CLASS_VOIP);
+            sampler.ConnectSender(ftpApps.Get(i), QOS_CLASS_FTP);
+        }
+        sampler.ConnectSink(voipSinks.Get(0), QOS_CLASS_VOIP);
+        sampler.ConnectSink(ftpSinks.Get(0), QOS_CLASS_FTP);
+        sampler.Start(cfg.timeSeriesFile, cfg.timeSeriesBinary, Seconds(cfg.timeSeriesInterval));
+    }
+
     // Schedule periodic check of metrics (Q3 Verification)
-    Simulator::Schedule(Seconds(SIMULATION_TIME - 2.0), &CheckMetrics, flowMonitor, &flowHelper);
+    if (flowMonitor) {
+        Simulator::Schedule(Seconds(cfg.simTime - 2.0), &CollectMetrics, flowMonitor, &flowHelper, &aggregator);
+    }
 
-    // 8. Run Simulation
-    Simulator::Stop(Seconds(SIMULATION_TIME));
+    // 8. Run Simulation; a warm-started group forks into its variants after the warm-up
+    int variant = -1;
+    if (warmStart) {
+        NS_ABORT_MSG_IF(timeSeries, "Warm start: --timeSeries cannot follow a fork (background writer thread)");
+        NS_ABORT_MSG_IF(cfg.warmup >= cfg.simTime - 3.0, "Warm start: --warmup must end before the sources stop");
+        Simulator::Stop(Seconds(cfg.warmup));
+        Simulator::Run();
+        variant = warmStart->Fork();
+        if (variant < 0) {
+            Simulator::Destroy();
+            return result;
+        }
+        // Only --warmupRetune groups variants whose rates or sizes differ from the warm-up's
+        const QosConfig& v = warmStart->GetVariant(variant);
+        if (cfg.warmupRetune && cfg.topologyFile.empty()) {
+            topo.GetDevice("n0", "bottleneck")->SetAttribute("DataRate", StringValue(v.linkRate));
+            topo.GetDevice("n2", "bottleneck")->SetAttribute("DataRate", StringValue(v.linkRate));
+        }
+        if (cfg.warmupRetune && cfg.traffic == "onoff") {
+            for (uint32_t i = 0; i < voipApps.GetN(); ++i)
+            {
+                voipApps.Get(i)->SetAttribute("DataRate", StringValue(v.voipRate));
+                voipApps.Get(i)->SetAttribute("PacketSize", UintegerValue(v.voipPacketSize));
+                ftpApps.Get(i)->SetAttribute("DataRate", StringValue(v.ftpRate));
+                ftpApps.Get(i)->SetAttribute("PacketSize", UintegerValue(v.ftpPacketSize));
+            }
+        }
+        aggregator.SetBaseline(flowMonitor);
+    }
+    Simulator::Stop(Seconds(cfg.simTime) - Simulator::Now());
     Simulator::Run();
     
-    flowMonitor->CheckForLostPackets();
+    if (flowMonitor) {
+        flowMonitor->CheckForLostPackets();
+    }
+    if (timeSeries) {
+        sampler.Stop();
+    }
+    if (distributed) {
+        aggregator.MergePartitions();
+        bottleneckQueues.MergePartitions();
+    }
+    CheckMetrics(&aggregator, &cfg, &bottleneckQueues, &result);
     Simulator::Destroy();
+    if (variant >= 0) {
+        warmStart->Finish(variant, result);
+    }
+    return result;
+}
+
+// =================================================================
+// Parameter Sweep (one forked process per replica)
+// =================================================================
+
+// Expands "a,b,c" into its items, or "start:stop:step" into numbers with 'unit'
+// appended (e.g. "2:10:2" with unit "Mbps" -> 2Mbps,4Mbps,...,10Mbps)
+std::vector<std::string> ExpandSweepList(const std::string& spec, const std::string& unit)
+{
+    std::vector<std::string> values;
+    if (std::count(spec.begin(), spec.end(), ':') == 2) {
+        std::istringstream in(spec);
+        double start, stop, step;
+        char sep;
+        in >> start >> sep >> stop >> sep >> step;
+        NS_ABORT_MSG_IF(!in || step <= 0.0, "Sweep: bad range '" << spec << "'");
+        for (double v = start; v <= stop + step * 1e-9; v += step)
+        {
+            std::ostringstream os;
+            os << v << unit;
+            values.push_back(os.str());
+        }
+        return values;
+    }
+
+    std::istringstream in(spec);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        if (!item.empty()) {
+            values.push_back(item);
+        }
+    }
+    NS_ABORT_MSG_IF(values.empty(), "Sweep: empty list '" << spec << "'");
+    return values;
+}
+
+std::string SweepHeader()
+{
+    return "linkRate,simTime,voipRate,ftpRate,voipPacketSize,ftpPacketSize,run,"
+           "voipTx,voipRx,voipLossPct,voipDelayMs,voipJitterMs,voipThroughputMbps,voipP50Ms,voipP99Ms,voipP999Ms,"
+           "ftpTx,ftpRx,ftpLossPct,ftpDelayMs,ftpJitterMs,ftpThroughputMbps,ftpP50Ms,ftpP99Ms,ftpP999Ms";
+}
+
+std::string SweepRow(const QosConfig& cfg, const QosRunResult& r)
+{
+    std::ostringstream os;
+    os << cfg.linkRate << "," << cfg.simTime << "," << cfg.voipRate << "," << cfg.ftpRate << ","
+       << cfg.voipPacketSize << "," << cfg.ftpPacketSize << "," << cfg.run << ","
+       << r.voip.txPackets << "," << r.voip.rxPackets << "," << r.voip.lossPct << "," << r.voip.delayMs << ","
+       << r.voip.jitterMs << "," << r.voip.throughputMbps << ","
+       << r.voip.p50DelayMs << "," << r.voip.p99DelayMs << "," << r.voip.p999DelayMs << ","
+       << r.ftp.txPackets << "," << r.ftp.rxPackets << "," << r.ftp.lossPct << "," << r.ftp.delayMs << ","
+       << r.ftp.jitterMs << "," << r.ftp.throughputMbps << ","
+       << r.ftp.p50DelayMs << "," << r.ftp.p99DelayMs << "," << r.ftp.p999DelayMs;
+    return os.str();
+}
+
+// A forked sweep or warm-start child and what it has written to its pipe so far
+struct ForkedChild
+{
+    uint32_t index;                     // Group or variant it runs
+    int fd;                             // Read end of its pipe
+    std::string output;
+};
+
+// Reads from every running child's pipe until one of them closes it, then reaps
+// that child and returns its pid. Pipes are drained before waitpid(), so a child
+// writing more than the pipe buffer holds cannot block while we wait for it.
+pid_t CollectChild(std::map<pid_t, ForkedChild>& running, int* status)
+{
+    std::vector<struct pollfd> fds;
+    std::vector<pid_t> pids;
+    while (true)
+    {
+        fds.clear();
+        pids.clear();
+        for (const auto& r : running)
+        {
+            struct pollfd p;
+            p.fd = r.second.fd;
+            p.events = POLLIN;
+            p.revents = 0;
+            fds.push_back(p);
+            pids.push_back(r.first);
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            NS_ABORT_MSG_IF(errno != EINTR, "poll() on child pipes failed");
+            continue;
+        }
+        for (uint32_t i = 0; i < fds.size(); ++i)
+        {
+            if (fds[i].revents == 0) {
+                continue;
+            }
+            ForkedChild& child = running[pids[i]];
+            char buf[4096];
+            ssize_t n = read(child.fd, buf, sizeof(buf));
+            if (n > 0) {
+                child.output.append(buf, n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            close(child.fd);
+            while (waitpid(pids[i], status, 0) < 0 && errno == EINTR)
+            {
+            }
+            return pids[i];
+        }
+    }
+}
+
+int QosWarmStart::Fork()
+{
+    std::map<pid_t, ForkedChild> running;
+    uint32_t next = 0;
+    while (next < m_variants.size() || !running.empty())
+    {
+        while (next < m_variants.size() && running.size() < m_jobs)
+        {
+            int fds[2];
+            NS_ABORT_MSG_IF(pipe(fds) != 0, "Warm start: pipe() failed");
+            std::cout.flush();
+            pid_t pid = fork();
+            NS_ABORT_MSG_IF(pid < 0, "Warm start: fork() failed");
+            if (pid == 0) {
+                close(fds[0]);
+                for (const auto& r : running)
+                {
+                    close(r.second.fd);
+                }
+                m_fd = fds[1];
+                return next;
+            }
+            close(fds[1]);
+            running[pid] = ForkedChild{next++, fds[0], std::string()};
+        }
+
+        int status = 0;
+        std::map<pid_t, ForkedChild>::iterator it = running.find(CollectChild(running, &status));
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            m_rows[it->second.index] = it->second.output;
+        }
+        running.erase(it);
+    }
+    return -1;
+}
+
+void QosWarmStart::Finish(int index, const QosRunResult& result)
+{
+    std::string row = SweepRow(m_variants[index], result) + "\n";
+    ssize_t written = write(m_fd, row.data(), row.size());
+    close(m_fd);
+    _exit(written == static_cast<ssize_t>(row.size()) ? 0 : 1);
+}
+
+// Whether b simulates exactly the warm-up of a
+bool SameWarmup(const QosConfig& a, const QosConfig& b)
+{
+    return a.run == b.run && a.simTime == b.simTime && a.linkRate == b.linkRate &&
+           a.voipRate == b.voipRate && a.ftpRate == b.ftpRate &&
+           a.voipPacketSize == b.voipPacketSize && a.ftpPacketSize == b.ftpPacketSize;
+}
+
+// Variants that can share one warm-up: identical ones or, with --warmupRetune,
+// any of the same run and length that the fork can retune (the OnOff packet
+// sizes can be changed in flight, other sources' cannot)
+bool SharesWarmup(const QosConfig& a, const QosConfig& b)
+{
+    if (!a.warmupRetune) {
+        return SameWarmup(a, b);
+    }
+    return a.run == b.run && a.simTime == b.simTime &&
+           (a.traffic == "onoff" || (a.voipPacketSize == b.voipPacketSize && a.ftpPacketSize == b.ftpPacketSize));
+}
+
+// Runs every configuration in its own child process (at most 'jobs' at once), so
+// each replica gets a fresh Simulator singleton. Children send their CSV row back
+// over a pipe; rows are written in configuration order once all runs finish.
+// With --warmup, configurations sharing a warm-up run as one job that forks its
+// variants after simulating the warm-up once (see QosWarmStart); the jobs are
+// split between the groups and their variants.
+void RunSweep(const std::vector<QosConfig>& configs, uint32_t jobs, const std::string& output)
+{
+    std::vector<std::vector<uint32_t> > groups;
+    for (uint32_t i = 0; i < configs.size(); ++i)
+    {
+        std::vector<std::vector<uint32_t> >::iterator g = groups.begin();
+        while (configs[i].warmup > 0.0 && g != groups.end() && !SharesWarmup(configs[g->front()], configs[i]))
+        {
+            ++g;
+        }
+        if (configs[i].warmup > 0.0 && g != groups.end()) {
+            g->push_back(i);
+        } else {
+            groups.push_back(std::vector<uint32_t>(1, i));
+        }
+    }
+    uint32_t groupJobs = std::min<uint32_t>(jobs, groups.size());
+    uint32_t variantJobs = std::max(1u, jobs / groupJobs);
+
+    std::vector<std::string> rows(configs.size());
+    std::map<pid_t, ForkedChild> running;
+    uint32_t next = 0;
+    uint32_t failed = 0;
+
+    std::cout << "Sweep: " << configs.size() << " runs";
+    if (groups.size() < configs.size()) {
+        std::cout << " forked from " << groups.size() << " warm-ups";
+    }
+    std::cout << " on " << jobs << " parallel processes\n";
+    for (const std::vector<uint32_t>& g : groups)
+    {
+        for (uint32_t c : g)
+        {
+            if (!SameWarmup(configs[g[0]], configs[c])) {
+                std::cout << "Sweep: run " << c << " measures from run " << g[0] << "'s warm-up, retuned\n";
+            }
+        }
+    }
+    while (next < groups.size() || !running.empty())
+    {
+        while (next < groups.size() && running.size() < groupJobs)
+        {
+            int fds[2];
+            NS_ABORT_MSG_IF(pipe(fds) != 0, "Sweep: pipe() failed");
+            std::cout.flush();
+            pid_t pid = fork();
+            NS_ABORT_MSG_IF(pid < 0, "Sweep: fork() failed");
+            if (pid == 0) {
+                close(fds[0]);
+                std::string text;
+                if (configs[groups[next][0]].warmup > 0.0) {
+                    std::vector<QosConfig> variants;
+                    for (uint32_t c : groups[next])
+                    {
+                        variants.push_back(configs[c]);
+                    }
+                    QosWarmStart warmStart(variants, variantJobs);
+                    RunQosScenario(variants[0], &warmStart);
+                    for (uint32_t v = 0; v < warmStart.GetN(); ++v)
+                    {
+                        text += warmStart.GetRow(v).empty() ? "\n" : warmStart.GetRow(v);
+                    }
+                } else {
+                    text = SweepRow(configs[groups[next][0]], RunQosScenario(configs[groups[next][0]])) + "\n";
+                }
+                ssize_t written = write(fds[1], text.data(), text.size());
+                close(fds[1]);
+                _exit(written == static_cast<ssize_t>(text.size()) ? 0 : 1);
+            }
+            close(fds[1]);
+            running[pid] = ForkedChild{next++, fds[0], std::string()};
+        }
+
+        int status = 0;
+        std::map<pid_t, ForkedChild>::iterator it = running.find(CollectChild(running, &status));
+
+        // One line per configuration of the group, empty if that run failed
+        bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        std::istringstream lines(it->second.output);
+        for (uint32_t c : groups[it->second.index])
+        {
+            std::string row;
+            if (ok && std::getline(lines, row) && !row.empty()) {
+                rows[c] = row + "\n";
+            } else {
+                ++failed;
+                std::cerr << "Sweep: run " << c << " failed\n";
+            }
+        }
+        running.erase(it);
+    }
+
+    std::ofstream out(output.c_str());
+    out << SweepHeader() << "\n";
+    for (uint32_t i = 0; i < rows.size(); ++i)
+    {
+        out << rows[i];
+    }
+    std::cout << "Sweep: " << (configs.size() - failed) << "/" << configs.size() << " runs written to " << output << "\n";
+}
+
+int main(int argc, char *argv[])
+{
+    QosConfig cfg;
+    bool sweep = false;
+    std::string linkRates, simTimes, voipRates, ftpRates, voipSizes, ftpSizes;
+    uint32_t runs = 1;
+    uint32_t jobs = std::max(1u, std::thread::hardware_concurrency());
+    std::string output = "scratch/qos-sweep.csv";
+    std::string scheduler = "map";
+    bool benchmark = false;
+    std::string benchSchedulers = "map,calendar,radix";
+    std::string benchNodes = "0,16,64";
+    std::string benchFlows = "1,16,64";
+    std::string benchOutput = "scratch/qos-benchmark.csv";
+    std::string golden;
+    bool goldenRecord = false;
+    bool distributed = false;
+
+    CommandLine cmd;
+    cmd.AddValue("topology", "Topology file (needs n0/n2 and a 'bottleneck' link)", cfg.topologyFile);
+    cmd.AddValue("linkRate", "Bottleneck link capacity", cfg.linkRate);
+    cmd.AddValue("simTime", "Total simulation time (s)", cfg.simTime);
+    cmd.AddValue("voipRate", "VoIP OnOff data rate", cfg.voipRate);
+    cmd.AddValue("ftpRate", "FTP OnOff data rate", cfg.ftpRate);
+    cmd.AddValue("voipPacketSize", "VoIP packet size (bytes)", cfg.voipPacketSize);
+    cmd.AddValue("ftpPacketSize", "FTP packet size (bytes)", cfg.ftpPacketSize);
+    cmd.AddValue("run", "RNG run number", cfg.run);
+    cmd.AddValue("aqm", "Best-effort AQM on the bottleneck: none, codel or ecn", cfg.aqm);
+    cmd.AddValue("aqmTarget", "CoDel sojourn target (s)", cfg.aqmTarget);
+    cmd.AddValue("aqmInterval", "CoDel interval (s)", cfg.aqmInterval);
+    cmd.AddValue("aqmLimit", "Packet limit over all best-effort flow queues", cfg.aqmLimit);
+    cmd.AddValue("contracts", "Per-class contracts class:police|shape:CIR:CBS:PIR:PBS[,...]", cfg.contracts);
+    cmd.AddValue("traffic", "Sources: onoff (constant rate), models (VoIP/bulk/video) or trace", cfg.traffic);
+    cmd.AddValue("voipFlows", "models: VoIP calls", cfg.voipFlows);
+    cmd.AddValue("ftpFlows", "models: TCP bulk transfers", cfg.ftpFlows);
+    cmd.AddValue("videoFlows", "models: AF41 video streams", cfg.videoFlows);
+    cmd.AddValue("videoRate", "models: mean rate per video stream", cfg.videoRate);
+    cmd.AddValue("trafficTrace", "trace: file of '<interArrivalUs> <size> <dscp>' lines", cfg.trafficTrace);
+    cmd.AddValue("traceFlows", "trace: flows replaying the file", cfg.traceFlows);
+    cmd.AddValue("sites", "Source sites behind HQ sharing the flows (0 = sources on n0)", cfg.sites);
+    cmd.AddValue("timeSeries", "Write a per-class time series to this file (empty = off)", cfg.timeSeriesFile);
+    cmd.AddValue("timeSeriesInterval", "Time series sampling interval (s)", cfg.timeSeriesInterval);
+    cmd.AddValue("timeSeriesBinary", "Write packed binary time series records instead of CSV", cfg.timeSeriesBinary);
+    cmd.AddValue("sweep", "Run a parameter sweep instead of a single simulation", sweep);
+    cmd.AddValue("linkRates", "Sweep: bottleneck rates, list or start:stop:step in Mbps", linkRates);
+    cmd.AddValue("simTimes", "Sweep: simulation times, list or start:stop:step", simTimes);
+    cmd.AddValue("voipRates", "Sweep: VoIP rates, list or start:stop:step in Mbps", voipRates);
+    cmd.AddValue("ftpRates", "Sweep: FTP rates, list or start:stop:step in Mbps", ftpRates);
+    cmd.AddValue("voipPacketSizes", "Sweep: VoIP packet sizes, list or start:stop:step", voipSizes);
+    cmd.AddValue("ftpPacketSizes", "Sweep: FTP packet sizes, list or start:stop:step", ftpSizes);
+    cmd.AddValue("warmup", "Sweep: simulate the first N s once and fork every combination with that warm-up from it (0 = off)", cfg.warmup);
+    cmd.AddValue("warmupRetune", "Sweep: also fork combinations with other rates or sizes from one warm-up, retuned at the fork", cfg.warmupRetune);
+    cmd.AddValue("runs", "Sweep: replicas (run numbers run..run+runs-1) per combination", runs);
+    cmd.AddValue("jobs", "Sweep: parallel processes", jobs);
+    cmd.AddValue("output", "Sweep: merged results CSV", output);
+    cmd.AddValue("scheduler", "Event scheduler: map, list, heap, calendar, priority or radix", scheduler);
+    cmd.AddValue("benchmark", "Run the scheduler benchmark instead of a single simulation", benchmark);
+    cmd.AddValue("benchSchedulers", "Benchmark: schedulers, comma-separated", benchSchedulers);
+    cmd.AddValue("benchNodes", "Benchmark: source sites, comma-separated", benchNodes);
+    cmd.AddValue("benchFlows", "Benchmark: VoIP and bulk flows each (models traffic), comma-separated", benchFlows);
+    cmd.AddValue("benchOutput", "Benchmark: results CSV", benchOutput);
+    cmd.AddValue("golden", "Check one headless run against the bands in this golden file (exit 1 on failure)", golden);
+    cmd.AddValue("goldenRecord", "Record the golden bands from this run instead of checking them", goldenRecord);
+    cmd.AddValue("distributed", "One process per site (needs ns-3 with MPI; run under mpirun)", distributed);
+    cmd.Parse(argc, argv);
+
+    if (distributed) {
+        NS_ABORT_MSG_IF(benchmark || sweep || !golden.empty(), "--distributed runs a single simulation (no --benchmark, --sweep or --golden)");
+        NS_ABORT_MSG_IF(!cfg.timeSeriesFile.empty(), "--timeSeries needs a single-process run");
+        NS_ABORT_MSG_IF(cfg.traffic == "trace" || cfg.videoFlows > 0,
+                        "--distributed counts classes per source application: no trace traffic or --videoFlows");
+#ifdef NS3_MPI
+        SelectScheduler(scheduler);
+        GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::DistributedSimulatorImpl"));
+        MpiInterface::Enable(&argc, &argv);
+        cfg.systems = MpiInterface::GetSize();
+        cfg.systemId = MpiInterface::GetSystemId();
+        RunQosScenario(cfg);
+        MpiInterface::Disable();
+        return 0;
+#else
+        NS_FATAL_ERROR("--distributed needs ns-3 configured with --enable-mpi");
+#endif
+    }
+
+    if (benchmark) {
+        RunSchedulerBenchmark("qos", ExpandSchedulerBenchmark(benchSchedulers, benchNodes, benchFlows),
+            [&cfg](const SchedulerBenchmarkCase& c) {
+                QosConfig bench = cfg;
+                bench.sites = c.nodes;
+                bench.traffic = "models";
+                bench.voipFlows = c.flows;
+                bench.ftpFlows = c.flows;
+                bench.verbose = false;
+                RunQosScenario(bench);
+            }, benchOutput);
+        return 0;
+    }
+    SelectScheduler(scheduler);     // Sweep children inherit it
+
+    if (!golden.empty()) {
+        // Regression gate: EF loss and latency, BE throughput, events and wall time
+        LogComponentDisableAll(LOG_LEVEL_ALL);
+        cfg.verbose = false;
+        RegressionGate gate("qos", golden, goldenRecord);
+        gate.Watch();
+        QosRunResult r = RunQosScenario(cfg);
+        gate.CheckCeiling("efLossPct", r.voip.lossPct, 0.5);
+        gate.Check("efDelayMs", r.voip.delayMs, std::max(1.0, r.voip.delayMs * 0.1));
+        gate.Check("efP99DelayMs", r.voip.p99DelayMs, std::max(1.0, r.voip.p99DelayMs * 0.1));
+        gate.Check("beThroughputMbps", r.ftp.throughputMbps, r.ftp.throughputMbps * 0.1);
+        return gate.Finish() ? 0 : 1;
+    }
+
+    if (!sweep) {
+        RunQosScenario(cfg);
+        return 0;
+    }
+
+    std::ostringstream simTime, voipSize, ftpSize;
+    simTime << cfg.simTime;
+    voipSize << cfg.voipPacketSize;
+    ftpSize << cfg.ftpPacketSize;
+    std::vector<std::string> linkRateList = ExpandSweepList(linkRates.empty() ? cfg.linkRate : linkRates, "Mbps");
+    std::vector<std::string> simTimeList = ExpandSweepList(simTimes.empty() ? simTime.str() : simTimes, "");
+    std::vector<std::string> voipRateList = ExpandSweepList(voipRates.empty() ? cfg.voipRate : voipRates, "Mbps");
+    std::vector<std::string> ftpRateList = ExpandSweepList(ftpRates.empty() ? cfg.ftpRate : ftpRates, "Mbps");
+    std::vector<std::string> voipSizeList = ExpandSweepList(voipSizes.empty() ? voipSize.str() : voipSizes, "");
+    std::vector<std::string> ftpSizeList = ExpandSweepList(ftpSizes.empty() ? ftpSize.str() : ftpSizes, "");
+
+    std::vector<QosConfig> configs;
+    for (const std::string& linkRate : linkRateList)
+    for (const std::string& time : simTimeList)
+    for (const std::string& voipRate : voipRateList)
+    for (const std::string& ftpRate : ftpRateList)
+    for (const std::string& voipPacketSize : voipSizeList)
+    for (const std::string& ftpPacketSize : ftpSizeList)
+    for (uint32_t r = 0; r < runs; ++r)
+    {
+        QosConfig c = cfg;
+        c.linkRate = linkRate;
+        c.simTime = std::stod(time);
+        c.voipRate = voipRate;
+        c.ftpRate = ftpRate;
+        c.voipPacketSize = std::stoul(voipPacketSize);
+        c.ftpPacketSize = std::stoul(ftpPacketSize);
+        c.run = cfg.run + r;
+        c.verbose = false;
+        if (!cfg.timeSeriesFile.empty()) {
+            c.timeSeriesFile = cfg.timeSeriesFile + "." + std::to_string(configs.size());
+        }
+        configs.push_back(c);
+    }
+
+    NS_ABORT_MSG_IF(cfg.warmupRetune && cfg.warmup <= 0.0, "--warmupRetune needs --warmup");
+    RunSweep(configs, std::max(1u, jobs), output);
     return 0;
 }
@@ -0,0 +1,154 @@
+/*
+ * Golden-band regression gate shared by the exercise scripts (--golden).
+ *
+ * A golden file holds one band per line, '#' starts a comment:
+ *
+ *   <scenario>.<metric> <min> <max>
+ *
+ * A script measures its metrics headless, checks each one against the band of
+ * the same name and fails (exit status 1) if any falls outside it. Besides the
+ * scenario's own metrics every gate checks <scenario>.events (events processed
+ * by all simulations of the run) and <scenario>.wallSeconds, so performance
+ * regressions fail like correctness ones. Every metric a scenario checks needs
+ * a band: a missing one fails the gate, so a metric cannot silently go ungated.
+ *
+ * Record mode (--goldenRecord) writes bands around the measured values instead
+ * of checking them, replacing the scenario's lines and keeping everything else.
+ */
+
+#ifndef REGRESSION_GATE_H
+#define REGRESSION_GATE_H
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+class RegressionGate
+{
+public:
+    RegressionGate(const std::string& scenario, const std::string& path, bool record)
+    : m_scenario(scenario), m_path(path), m_record(record), m_events(0), m_failed(0),
+      m_start(std::chrono::steady_clock::now())
+    {
+        std::ifstream in(path.c_str());
+        NS_ABORT_MSG_IF(!in.is_open() && !record, "Regression: cannot open golden file " << path);
+        std::string line;
+        while (std::getline(in, line))
+        {
+            m_lines.push_back(line);
+            std::istringstream fields(line.substr(0, line.find('#')));
+            std::string name;
+            double min, max;
+            if (!(fields >> name)) {
+                continue;
+            }
+            NS_ABORT_MSG_IF(!(fields >> min >> max) || min > max, "Regression: bad band '" << line << "' in " << path);
+            m_bands[name] = std::make_pair(min, max);
+        }
+    }
+
+    // Counts the events of the simulator that is current now; call once per
+    // simulation, before it runs (the count is taken when it is destroyed)
+    void Watch() { Simulator::ScheduleDestroy(&RegressionGate::CountEvents, this); }
+
+    // Band [value - slack, value + slack] when recording
+    void Check(const std::string& metric, double value, double slack) { Add(metric, value, value - slack, value + slack); }
+
+    // Band [0, value + slack] when recording: only growth is a regression
+    void CheckCeiling(const std::string& metric, double value, double slack) { Add(metric, value, 0.0, value + slack); }
+
+    // Adds the event and wall-clock checks, prints the verdict and, in record
+    // mode, rewrites the golden file. Returns false if a metric is out of its
+    // band or has none.
+    bool Finish()
+    {
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+        Check("events", m_events, m_events * 0.05);
+        CheckCeiling("wallSeconds", wall, std::max(1.0, wall * 0.5));
+
+        if (m_record) {
+            Write();
+            std::cout << "Regression " << m_scenario << ": " << m_results.size() << " bands recorded in " << m_path << "\n";
+            return true;
+        }
+        std::cout << "Regression " << m_scenario << ": " << (m_failed ? "FAIL" : "PASS") << " (" << m_failed
+                  << " of " << m_results.size() << " metrics out of band or without one)\n";
+        return m_failed == 0;
+    }
+
+private:
+    struct Result
+    {
+        std::string name;
+        double value;
+        double min;         // Band recorded in record mode
+        double max;
+    };
+
+    static void CountEvents(RegressionGate* gate) { gate->m_events += Simulator::GetEventCount(); }
+
+    void Add(const std::string& metric, double value, double min, double max)
+    {
+        Result r;
+        r.name = m_scenario + "." + metric;
+        r.value = value;
+        r.min = min;
+        r.max = max;
+        m_results.push_back(r);
+        if (m_record) {
+            return;
+        }
+
+        std::map<std::string, std::pair<double, double> >::const_iterator band = m_bands.find(r.name);
+        std::cout << "  " << r.name << " = " << value;
+        if (band == m_bands.end()) {
+            std::cout << " (no band in " << m_path << ", record one with regression.sh record) FAIL\n";
+            ++m_failed;
+            return;
+        }
+        bool pass = value >= band->second.first && value <= band->second.second;
+        m_failed += pass ? 0 : 1;
+        std::cout << " [" << band->second.first << ", " << band->second.second << "]" << (pass ? "" : " FAIL") << "\n";
+    }
+
+    void Write() const
+    {
+        std::string prefix = m_scenario + ".";
+        std::ofstream out(m_path.c_str());
+        NS_ABORT_MSG_IF(!out.is_open(), "Regression: cannot write golden file " << m_path);
+        for (const std::string& line : m_lines)
+        {
+            if (line.compare(0, prefix.size(), prefix) != 0) {
+                out << line << "\n";
+            }
+        }
+        for (const Result& r : m_results)
+        {
+            out << r.name << " " << r.min << " " << r.max << "\n";
+        }
+    }
+
+    std::string m_scenario;
+    std::string m_path;
+    bool m_record;
+    std::vector<std::string> m_lines;                               // Golden file as read
+    std::map<std::string, std::pair<double, double> > m_bands;     // Metric -> [min, max]
+    std::vector<Result> m_results;
+    uint64_t m_events;
+    uint32_t m_failed;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace ns3
+
+#endif /* REGRESSION_GATE_H */
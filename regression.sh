@@ -0,0 +1,44 @@
+#!/bin/sh
+# Regression suite: builds ns-3 and runs the three scenarios headless, logging
+# off, each gated on the tolerance bands of regression-golden.txt (correctness
+# metrics plus events processed and wall-clock time). Exits non-zero if any
+# scenario leaves its bands, so it can be chained after the build.
+#
+# Run from the ns-3 root with these scripts in scratch/:
+#   ./scratch/regression.sh          check against the golden bands
+#   ./scratch/regression.sh record   re-record the bands from this build
+# GOLDEN=<file> selects another golden file; SCHEDULER=<name> another event queue.
+
+GOLDEN=${GOLDEN:-scratch/regression-golden.txt}
+SCHEDULER=${SCHEDULER:-map}
+RECORD=false
+if [ "$1" = "record" ]; then
+    RECORD=true
+fi
+
+# Every scenario must gate its performance, not only its correctness metrics
+status=0
+for scenario in qos pbr router
+do
+    for metric in events wallSeconds
+    do
+        if [ "$RECORD" = false ] && ! grep -q "^$scenario\.$metric " "$GOLDEN"; then
+            echo "Regression: NO $scenario.$metric BAND in $GOLDEN, record one with '$0 record'" >&2
+            status=1
+        fi
+    done
+done
+
+./ns3 build || exit 1
+
+for script in qos-implementation pbr-simulation-complete router-static-routing
+do
+    ./ns3 run --no-build "scratch/$script --golden=$GOLDEN --goldenRecord=$RECORD --scheduler=$SCHEDULER" || status=1
+done
+
+if [ $status -ne 0 ]; then
+    echo "Regression: FAILED"
+else
+    echo "Regression: passed"
+fi
+exit $status
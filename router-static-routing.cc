@@ -1,7 +1,25 @@
 /*
  * Exercise 1: Multi-Site WAN Extension (HQ, Branch, DC)
  * Topology: Triangular Mesh (n0 <-> n1 <-> n2, plus n0 <-> n2)
- * All links 5Mbps, 2ms. Static routing with Metric 0 (Direct) / Metric 1 (Via Branch).
+ * All links 5Mbps, 2ms. Routes are computed by link-state routing (SPF over link
+ * costs) and installed into Ipv4StaticRouting; the link failure is flooded and only
+ * the affected part of each shortest-path tree is recomputed.
+ * The failure is a silent cut of the link; BFD-style hellos (--bfdInterval,
+ * --bfdMultiplier) detect it on both ends and link-state routing moves traffic off it.
+ * --benchmark runs headless: a high-rate probe flow crosses the --failures link
+ * cuts and each cut's loss window, reordering and time-to-recover are written,
+ * per run (--runs seeds), to a CSV summary. --maxRecoverMs makes it a gate.
+ * Tracing: --pcap writes one block-buffered capture of all links, optionally
+ * sampled (--pcapSample), cut to --pcapSnaplen and filtered (--pcapDscp,
+ * --pcapFlow); --anim animates packets only in [--animStart, --animStop].
+ * --fib switches every router to the trie-based FibRouting; --fibRoutes=<file>
+ * bulk-loads a large route table into the HQ FIB.
+ * Nodes, links and addresses come from WAN_TOPOLOGY (or --topology).
+ * --distributed (ns-3 built with MPI, e.g. mpirun -np 3) simulates every site in
+ * its own process; the 2ms WAN links are the lookahead between them.
+ * --scheduler selects the event queue (map, list, heap, calendar, priority, radix).
+ * --golden=<file> runs the benchmark gated on the file's tolerance bands (see
+ * regression-gate.h and regression.sh).
  */
 
 #include "ns3/applications-module.h"
@@ -11,199 +29,590 @@
 #include "ns3/netanim-module.h"
 #include "ns3/network-module.h"
 #include "ns3/point-to-point-module.h"
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+#include "bfd-liveness.h"
+#include "fib-routing.h"
+#include "link-state-routing.h"
+#include "packet-tracer.h"
+#include "regression-gate.h"
+#include "scheduler-benchmark.h"
+#include "wan-topology.h"
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("RouterStaticRouting");
 
-// Function for Q3: Disables a network device (simulating a link failure)
-void SetLinkDown(Ptr<NetDevice> netDevice)
+// HQ (n0), Branch (n1), DC (n2); positions form the NetAnim triangle, each is its own site
+const std::string WAN_TOPOLOGY =
+    "defaults rate=5Mbps delay=2ms\n"
+    "node n0 x=5 y=20 site=0\n"      // HQ (Top Left)
+    "node n1 x=15 y=5 site=1\n"      // Branch (Bottom)
+    "node n2 x=25 y=20 site=2\n"     // DC (Top Right)
+    "link net1 n0 n1 subnet=10.1.1.0/24\n"
+    "link net2 n1 n2 subnet=10.1.2.0/24\n"
+    "link net3 n0 n2 subnet=10.1.3.0/24\n";  // Q1: New Link 3
+
+// "<label>\n<addr> | <addr>" description of a node for NetAnim
+std::string Describe(const WanTopology& topo, const std::string& label, const std::string& node,
+                     const std::string& linkA, const std::string& linkB)
 {
-    // Get the node and its IPv4 object
-    Ptr<Node> node = netDevice->GetNode();
-    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
-    
-    // Find the interface index for this device and set it down
-    int32_t interfaceIndex = ipv4->GetInterfaceForDevice(netDevice);
-    if (interfaceIndex != -1)
+    std::ostringstream os;
+    os << label << "\\n" << topo.GetAddress(node, linkA) << " | " << topo.GetAddress(node, linkB);
+    return os.str();
+}
+
+// Function for Q3: Cuts a link (simulating a fibre cut). Both devices silently
+// lose every packet; nothing is told to IP or routing, BFD has to notice.
+void SetLinkDown(NetDeviceContainer link)
+{
+    for (uint32_t i = 0; i < link.GetN(); ++i)
     {
-        ipv4->SetDown(interfaceIndex);
-        NS_LOG_INFO("Primary Link Interface " << interfaceIndex << " on Node " 
-                    << node->GetId() << " is DOWN. Failover expected.");
+        Ptr<RateErrorModel> cut = CreateObject<RateErrorModel>();
+        cut->SetAttribute("ErrorRate", DoubleValue(1.0));
+        cut->SetAttribute("ErrorUnit", StringValue("ERROR_UNIT_PACKET"));
+        link.Get(i)->SetAttribute("ReceiveErrorModel", PointerValue(cut));
     }
+    NS_LOG_INFO("Link between nodes " << link.Get(0)->GetNode()->GetId() << " and "
+                << link.Get(1)->GetNode()->GetId() << " is CUT. Failover expected.");
 }
 
-int
-main(int argc, char* argv[])
+// BFD declared a session down (or back up): tell link-state routing
+void BfdStateChange(LinkStateRouting* routing, Ptr<Node> node, uint32_t interface, bool up)
 {
-    // Enable logging for the applications
-    LogComponentEnable("UdpEchoClientApplication", LOG_LEVEL_INFO);
-    LogComponentEnable("UdpEchoServerApplication", LOG_LEVEL_INFO);
+    NS_LOG_INFO("BFD: node " << node->GetId() << " interface " << interface << (up ? " UP" : " DOWN")
+                << " at " << Simulator::Now().GetSeconds() << "s");
+    if (up) {
+        routing->NotifyInterfaceUp(node, interface);
+    } else {
+        routing->NotifyInterfaceDown(node, interface);
+    }
+}
 
-    // Create three nodes: n0 (HQ), n1 (Branch/Router), n2 (DC/Server)
-    NodeContainer nodes;
-    nodes.Create(3);
+// Scenario parameters; the defaults reproduce the original exercise
+struct RouterConfig
+{
+    std::string topologyFile;
+    bool useFib = false;
+    std::string fibRoutes;
+    double bfdInterval = 10.0;          // ms
+    uint32_t bfdMultiplier = 3;
+    std::string failures = "net3@4";    // Link cuts, "<link>@<seconds>[,...]"
+    double simTime = 11.0;
+    uint32_t run = 1;
+    bool benchmark = false;             // Headless probe run instead of the echo demo
+    double probeInterval = 1.0;         // ms between probe packets
+    uint32_t probeSize = 64;
+    uint32_t systems = 1;               // Partitions of a distributed run
+    uint32_t systemId = 0;              // Partition simulated by this process
+    bool pcap = true;
+    uint32_t pcapSample = 1;            // Keep 1 in N matching packets
+    uint32_t pcapSnaplen = 65535;
+    int pcapDscp = -1;                  // -1 = any DSCP
+    std::string pcapFlow;               // "<src>><dst>[:port]", '*' = any address
+    bool anim = true;
+    double animStart = 0.0;
+    double animStop = 0.0;              // 0 = until the end
+    bool animMetadata = false;
+};
+
+// One link cut as seen by the probe flow
+struct ConvergenceEvent
+{
+    uint32_t run;
+    std::string link;
+    double failTime;
+    uint32_t probes;            // Probes sent between this cut and the next one
+    uint32_t lost;
+    uint32_t reordered;
+    double lossWindowMs;        // First to last lost probe, inclusive
+    double recoverMs;           // Cut to first delivery after the outage; -1 if never
+};
+
+std::vector<std::pair<std::string, double> > ParseFailures(const std::string& spec)
+{
+    std::vector<std::pair<std::string, double> > failures;
+    std::istringstream in(spec);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        std::string::size_type at = item.find('@');
+        NS_ABORT_MSG_IF(at == std::string::npos, "Failures: expected <link>@<seconds>, got '" << item << "'");
+        failures.push_back(std::make_pair(item.substr(0, at), std::stod(item.substr(at + 1))));
+    }
+    std::sort(failures.begin(), failures.end(),
+              [](const std::pair<std::string, double>& a, const std::pair<std::string, double>& b) { return a.second < b.second; });
+    return failures;
+}
 
-    Ptr<Node> n0 = nodes.Get(0); // HQ
-    Ptr<Node> n1 = nodes.Get(1); // Branch/Router
-    Ptr<Node> n2 = nodes.Get(2); // DC/Server
+// =================================================================
+// Convergence Probe
+// =================================================================
 
-    // Configure all links (5Mbps, 2ms)
-    PointToPointHelper p2p;
-    p2p.SetDeviceAttribute("DataRate", StringValue("5Mbps"));
-    p2p.SetChannelAttribute("Delay", StringValue("2ms"));
+// Constant-rate UDP probe carrying SeqTs headers. The sender numbers every
+// probe it attempts, so the send time of a lost probe is known exactly.
+class ConvergenceProbe
+{
+public:
+    void Install(Ptr<Node> src, Ptr<Node> dst, Ipv4Address dstAddress, uint16_t port,
+                 Time interval, uint32_t size, Time start, Time stop)
+    {
+        NS_ABORT_MSG_IF(interval <= Time(0), "ConvergenceProbe: interval must be positive");
+        m_interval = interval;
+        m_size = size;
+        m_start = start;
+        m_count = static_cast<uint32_t>((stop - start).GetSeconds() / interval.GetSeconds());
+        m_rxTime.assign(m_count, -1.0);
+        m_reordered.assign(m_count, false);
+        m_maxSeq = 0;
+        m_received = 0;
+
+        // Either end may be null when it is simulated by another partition
+        if (dst) {
+            m_sink = Socket::CreateSocket(dst, UdpSocketFactory::GetTypeId());
+            m_sink->Bind(InetSocketAddress(Ipv4Address::GetAny(), port));
+            m_sink->SetRecvCallback(MakeCallback(&ConvergenceProbe::Receive, this));
+        }
+        if (src) {
+            m_source = Socket::CreateSocket(src, UdpSocketFactory::GetTypeId());
+            m_source->Connect(InetSocketAddress(dstAddress, port));
+            Simulator::Schedule(start, &ConvergenceProbe::Send, this, 0);
+        }
+    }
 
-    // Link 1: n0 <-> n1 (Network 1: 10.1.1.0/24)
-    NodeContainer link1Nodes(n0, n1);
-    NetDeviceContainer link1Devices = p2p.Install(link1Nodes);
+    // Loss window, reordering and recovery of the probes sent in [from, to); needs the sink
+    void Analyze(double from, double to, ConvergenceEvent& event) const
+    {
+        double interval = m_interval.GetSeconds();
+        uint32_t first = SeqAt(from), last = std::min(SeqAt(to), m_count);
+        event.probes = last > first ? last - first : 0;
+        event.lost = 0;
+        event.reordered = 0;
+        uint32_t firstLost = last, lastLost = last;
+        for (uint32_t seq = first; seq < last; ++seq)
+        {
+            if (m_rxTime[seq] < 0) {
+                ++event.lost;
+                firstLost = std::min(firstLost, seq);
+                lastLost = seq;
+            }
+            event.reordered += m_reordered[seq];
+        }
+        event.lossWindowMs = event.lost ? (lastLost - firstLost + 1) * interval * 1000.0 : 0.0;
+        event.recoverMs = event.lost ? -1.0 : 0.0;
+        for (uint32_t seq = lastLost + 1; event.lost && seq < last; ++seq)
+        {
+            if (m_rxTime[seq] >= 0) {
+                event.recoverMs = (m_rxTime[seq] - from) * 1000.0;
+                break;
+            }
+        }
+    }
 
-    // Link 2: n1 <-> n2 (Network 2: 10.1.2.0/24)
-    NodeContainer link2Nodes(n1, n2);
-    NetDeviceContainer link2Devices = p2p.Install(link2Nodes);
+private:
+    uint32_t SeqAt(double t) const
+    {
+        double offset = (t - m_start.GetSeconds()) / m_interval.GetSeconds();
+        return offset <= 0 ? 0 : static_cast<uint32_t>(std::ceil(offset - 1e-9));
+    }
 
-    // --- Q1: New Link 3: n0 <-> n2 (Network 3: 10.1.3.0/24) ---
-    NodeContainer link3Nodes(n0, n2);
-    NetDeviceContainer link3Devices = p2p.Install(link3Nodes);
+    void Send(uint32_t seq)
+    {
+        SeqTsHeader header;
+        header.SetSeq(seq);
+        Ptr<Packet> packet = Create<Packet>(m_size > header.GetSerializedSize() ? m_size - header.GetSerializedSize() : 0);
+        packet->AddHeader(header);
+        m_source->Send(packet);
+        if (seq + 1 < m_count) {
+            Simulator::Schedule(m_interval, &ConvergenceProbe::Send, this, seq + 1);
+        }
+    }
 
-    // Install mobility model (fixed positions for triangular layout)
-    MobilityHelper mobility;
-    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
-    mobility.Install(nodes);
+    void Receive(Ptr<Socket> socket)
+    {
+        Ptr<Packet> packet;
+        while ((packet = socket->Recv()))
+        {
+            SeqTsHeader header;
+            packet->RemoveHeader(header);
+            uint32_t seq = header.GetSeq();
+            if (seq >= m_count || m_rxTime[seq] >= 0) {
+                continue;
+            }
+            m_rxTime[seq] = Simulator::Now().GetSeconds();
+            if (m_received++ > 0 && seq < m_maxSeq) {
+                m_reordered[seq] = true;
+            }
+            m_maxSeq = std::max(m_maxSeq, seq);
+        }
+    }
 
-    // Set positions for the triangle (HQ, Branch, DC)
-    n0->GetObject<MobilityModel>()->SetPosition(Vector(5.0, 20.0, 0.0));  // HQ (Top Left)
-    n1->GetObject<MobilityModel>()->SetPosition(Vector(15.0, 5.0, 0.0));  // Branch (Bottom)
-    n2->GetObject<MobilityModel>()->SetPosition(Vector(25.0, 20.0, 0.0)); // DC (Top Right)
+    Time m_interval;
+    uint32_t m_size;
+    Time m_start;
+    uint32_t m_count;
+    std::vector<double> m_rxTime;       // Per sequence number; -1 while not received
+    std::vector<bool> m_reordered;
+    uint32_t m_maxSeq;
+    uint32_t m_received;
+    Ptr<Socket> m_source;
+    Ptr<Socket> m_sink;
+};
+
+// Flow filter from "<src>><dst>[:port]"; either address may be '*'
+void ApplyFlowFilter(PacketTracer& pcap, const std::string& spec)
+{
+    std::string::size_type gt = spec.find('>');
+    NS_ABORT_MSG_IF(gt == std::string::npos, "pcapFlow: expected <src>><dst>[:port], got '" << spec << "'");
+    std::string src = spec.substr(0, gt), dst = spec.substr(gt + 1);
+    uint16_t port = 0;
+    std::string::size_type colon = dst.find(':');
+    if (colon != std::string::npos) {
+        port = static_cast<uint16_t>(std::stoul(dst.substr(colon + 1)));
+        dst = dst.substr(0, colon);
+    }
+    pcap.SetFlowFilter(src == "*" ? Ipv4Address::GetAny() : Ipv4Address(src.c_str()),
+                       dst == "*" ? Ipv4Address::GetAny() : Ipv4Address(dst.c_str()), 0, port);
+}
 
-    // Install Internet stack on all nodes
-    InternetStackHelper stack;
-    stack.Install(nodes);
+// Output file suffix of this process in a distributed run
+std::string PartitionSuffix(const RouterConfig& cfg)
+{
+    if (cfg.systems == 1) {
+        return "";
+    }
+    std::ostringstream os;
+    os << "-" << cfg.systemId;
+    return os.str();
+}
 
-    // --- Q1: IP Address Assignment ---
+// --- One complete simulation of the scenario; benchmark runs fill events ---
+// Returns false if the probe sink (and so the benchmark result) lives in another partition.
+bool RunRouterScenario(const RouterConfig& cfg, std::vector<ConvergenceEvent>* events)
+{
+    RngSeedManager::SetRun(cfg.run);
 
-    // Network 1 (10.1.1.0/24) - n0 <-> n1
-    Ipv4AddressHelper address1;
-    address1.SetBase("10.1.1.0", "255.255.255.0");
-    Ipv4InterfaceContainer interfaces1 = address1.Assign(link1Devices);
+    // Enable logging for the applications
+    if (!cfg.benchmark) {
+        LogComponentEnable("UdpEchoClientApplication", LOG_LEVEL_INFO);
+        LogComponentEnable("UdpEchoServerApplication", LOG_LEVEL_INFO);
+    }
 
-    // Network 2 (10.1.2.0/24) - n1 <-> n2
-    Ipv4AddressHelper address2;
-    address2.SetBase("10.1.2.0", "255.255.255.0");
-    Ipv4InterfaceContainer interfaces2 = address2.Assign(link2Devices);
+    // Create three nodes: n0 (HQ), n1 (Branch/Router), n2 (DC/Server), the
+    // triangular mesh of 5Mbps/2ms links and addresses
+    WanTopology topo;
+    topo.SetPartitioning(cfg.systems, cfg.systemId);
+    if (cfg.topologyFile.empty()) {
+        topo.LoadString(WAN_TOPOLOGY);
+    } else {
+        topo.LoadFile(cfg.topologyFile);
+    }
+    NodeContainer nodes = topo.GetNodes();
 
-    // Network 3 (10.1.3.0/24) - n0 <-> n2
-    Ipv4AddressHelper address3;
-    address3.SetBase("10.1.3.0", "255.255.255.0");
-    Ipv4InterfaceContainer interfaces3 = address3.Assign(link3Devices);
+    Ptr<Node> n0 = topo.GetNode("n0"); // HQ
+    Ptr<Node> n1 = topo.GetNode("n1"); // Branch/Router
+    Ptr<Node> n2 = topo.GetNode("n2"); // DC/Server
 
-    // Enable IP forwarding on all nodes (n0, n1, n2)
-    n0->GetObject<Ipv4>()->SetAttribute("IpForward", BooleanValue(true));
-    n1->GetObject<Ipv4>()->SetAttribute("IpForward", BooleanValue(true));
-    n2->GetObject<Ipv4>()->SetAttribute("IpForward", BooleanValue(true));
+    // Enable IP forwarding on all nodes
+    for (uint32_t i = 0; i < nodes.GetN(); ++i)
+    {
+        nodes.Get(i)->GetObject<Ipv4>()->SetAttribute("IpForward", BooleanValue(true));
+    }
 
+    // Q2: Link-state routing replaces the hand-written metric 0/1 route pairs; the
+    // direct link wins on cost and the path through the Branch is found on failure
+    if (cfg.useFib || !cfg.fibRoutes.empty()) {
+        for (uint32_t i = 0; i < nodes.GetN(); ++i)
+        {
+            FibRouting::Install(nodes.Get(i));
+        }
+        if (!cfg.fibRoutes.empty() && topo.IsLocal(n0)) {
+            uint32_t loaded = FibRouting::Get(n0->GetObject<Ipv4>())->LoadRouteFile(cfg.fibRoutes);
+            std::cout << "Loaded " << loaded << " routes into the HQ FIB from " << cfg.fibRoutes << "\n";
+        }
+    }
+    LinkStateRouting linkState;
+    linkState.Install(topo);
+    linkState.Start();
 
-    // --- Q2: Configure Static Routing with Metrics ---
+    // Q3: Fast liveness detection on every link drives the failover
+    ApplicationContainer bfdApps = BfdLiveness::Install(topo, Seconds(cfg.bfdInterval / 1000.0), cfg.bfdMultiplier);
+    for (uint32_t i = 0; i < bfdApps.GetN(); ++i)
+    {
+        bfdApps.Get(i)->TraceConnectWithoutContext("StateChange", MakeBoundCallback(&BfdStateChange, &linkState));
+    }
+    bfdApps.Start(Seconds(0.5));
 
-    Ipv4StaticRoutingHelper staticRoutingHelper;
+    // --- Q3: Schedule the link failures (default: Network 3, n0 <-> n2, at t=4s) ---
+    // Each link is cut silently; BFD on both ends detects it.
+    std::vector<std::pair<std::string, double> > failures = ParseFailures(cfg.failures);
+    for (const std::pair<std::string, double>& failure : failures)
+    {
+        Simulator::Schedule(Seconds(failure.second), &SetLinkDown, topo.GetLinkDevices(failure.first));
+    }
 
-    // --- Routing on n0 (HQ) ---
-    Ptr<Ipv4StaticRouting> staticRoutingN0 = staticRoutingHelper.GetStaticRouting(n0->GetObject<Ipv4>());
-    // 1. PRIMARY Route (Metric 0): HQ -> DC via Net 3 (Direct link)
-    staticRoutingN0->AddNetworkRouteTo(
-        Ipv4Address("10.1.2.0"), Ipv4Mask("255.255.255.0"), // Destination Net 2
-        interfaces3.GetAddress(1),   // Next hop: 10.1.3.2 (N2's Net 3 IP)
-        2,                         // Outgoing Interface Index (N0's Net 3 interface)
-        0                          // Metric 0 (Primary)
-    );
-    // 2. BACKUP Route (Metric 1): HQ -> DC via Net 1 (Through Branch N1)
-    staticRoutingN0->AddNetworkRouteTo(
-        Ipv4Address("10.1.2.0"), Ipv4Mask("255.255.255.0"), // Destination Net 2
-        interfaces1.GetAddress(1),   // Next hop: 10.1.1.2 (N1's Net 1 IP)
-        1,                         // Outgoing Interface Index (N0's Net 1 interface)
-        1                          // Metric 1 (Backup)
-    );
-
-    // --- Routing on n2 (DC) ---
-    Ptr<Ipv4StaticRouting> staticRoutingN2 = staticRoutingHelper.GetStaticRouting(n2->GetObject<Ipv4>());
-    // 1. PRIMARY Return Route (Metric 0): DC -> HQ via Net 3 (Direct link)
-    staticRoutingN2->AddNetworkRouteTo(
-        Ipv4Address("10.1.1.0"), Ipv4Mask("255.255.255.0"), // Destination Net 1
-        interfaces3.GetAddress(0),   // Next hop: 10.1.3.1 (N0's Net 3 IP)
-        2,                         // Outgoing Interface Index (N2's Net 3 interface)
-        0                          // Metric 0 (Primary)
-    );
-    // 2. BACKUP Return Route (Metric 1): DC -> HQ via Net 2 (Through Branch N1)
-    staticRoutingN2->AddNetworkRouteTo(
-        Ipv4Address("10.1.1.0"), Ipv4Mask("255.255.255.0"), // Destination Net 1
-        interfaces2.GetAddress(0),   // Next hop: 10.1.2.1 (N1's Net 2 IP)
-        1,                         // Outgoing Interface Index (N2's Net 2 interface)
-        1                          // Metric 1 (Backup)
-    );
-
-
-    // Print routing tables
+    if (cfg.benchmark) {
+        // Probe HQ -> DC across every cut; nothing else is traced or printed
+        ConvergenceProbe probe;
+        Time probeStart = Seconds(1.0), probeStop = Seconds(cfg.simTime - 0.5);
+        probe.Install(topo.IsLocal(n0) ? n0 : Ptr<Node>(), topo.IsLocal(n2) ? n2 : Ptr<Node>(),
+                      topo.GetAddress("n2", "net2"), 5000, Seconds(cfg.probeInterval / 1000.0),
+                      cfg.probeSize, probeStart, probeStop);
+
+        Simulator::Stop(Seconds(cfg.simTime));
+        Simulator::Run();
+
+        for (uint32_t i = 0; topo.IsLocal(n2) && i < failures.size(); ++i)
+        {
+            ConvergenceEvent event;
+            event.run = cfg.run;
+            event.link = failures[i].first;
+            event.failTime = failures[i].second;
+            double until = i + 1 < failures.size() ? failures[i + 1].second : probeStop.GetSeconds();
+            probe.Analyze(failures[i].second, until, event);
+            events->push_back(event);
+        }
+        Simulator::Destroy();
+        return topo.IsLocal(n2);
+    }
+
+    // Print the local routers' tables before and after the failure has been flooded
+    std::string suffix = PartitionSuffix(cfg);
+    Ipv4StaticRoutingHelper staticRoutingHelper;
     Ptr<OutputStreamWrapper> routingStream =
-        Create<OutputStreamWrapper>("scratch/router-static-routing.routes", std::ios::out);
-    staticRoutingHelper.PrintRoutingTableAllAt(Seconds(1.0), routingStream);
+        Create<OutputStreamWrapper>("scratch/router-static-routing" + suffix + ".routes", std::ios::out);
+    for (double t : {1.0, 5.0})
+    {
+        for (uint32_t i = 0; i < nodes.GetN(); ++i)
+        {
+            if (topo.IsLocal(nodes.Get(i))) {
+                staticRoutingHelper.PrintRoutingTableAt(Seconds(t), nodes.Get(i), routingStream);
+            }
+        }
+    }
 
     // --- Q1: Console Output (Verification) ---
     std::cout << "\n=== Network Configuration ===\n";
-    std::cout << "Node 0 (HQ) Interface 1 (Net 1): " << interfaces1.GetAddress(0) << "\n";
-    std::cout << "Node 0 (HQ) Interface 2 (Net 3): " << interfaces3.GetAddress(0) << "\n";
+    std::cout << "Node 0 (HQ) Interface " << topo.GetInterfaceIndex("n0", "net1") << " (Net 1): " << topo.GetAddress("n0", "net1") << "\n";
+    std::cout << "Node 0 (HQ) Interface " << topo.GetInterfaceIndex("n0", "net3") << " (Net 3): " << topo.GetAddress("n0", "net3") << "\n";
     std::cout << "-----------------------------\n";
-    std::cout << "Node 1 (Branch) Interface 1 (Net 1): " << interfaces1.GetAddress(1) << "\n";
-    std::cout << "Node 1 (Branch) Interface 2 (Net 2): " << interfaces2.GetAddress(0) << "\n";
+    std::cout << "Node 1 (Branch) Interface " << topo.GetInterfaceIndex("n1", "net1") << " (Net 1): " << topo.GetAddress("n1", "net1") << "\n";
+    std::cout << "Node 1 (Branch) Interface " << topo.GetInterfaceIndex("n1", "net2") << " (Net 2): " << topo.GetAddress("n1", "net2") << "\n";
     std::cout << "-----------------------------\n";
-    std::cout << "Node 2 (DC) Interface 1 (Net 2): " << interfaces2.GetAddress(1) << "\n";
-    std::cout << "Node 2 (DC) Interface 2 (Net 3): " << interfaces3.GetAddress(1) << "\n";
+    std::cout << "Node 2 (DC) Interface " << topo.GetInterfaceIndex("n2", "net2") << " (Net 2): " << topo.GetAddress("n2", "net2") << "\n";
+    std::cout << "Node 2 (DC) Interface " << topo.GetInterfaceIndex("n2", "net3") << " (Net 3): " << topo.GetAddress("n2", "net3") << "\n";
     std::cout << "=============================\n\n";
 
     // Application Setup (Client N0 targets Server N2's IP on Net 2)
     uint16_t port = 9;
     UdpEchoServerHelper echoServer(port);
-    ApplicationContainer serverApps = echoServer.Install(n2);
-    serverApps.Start(Seconds(1.0));
-    serverApps.Stop(Seconds(10.0));
+    if (topo.IsLocal(n2)) {
+        ApplicationContainer serverApps = echoServer.Install(n2);
+        serverApps.Start(Seconds(1.0));
+        serverApps.Stop(Seconds(10.0));
+    }
 
-    UdpEchoClientHelper echoClient(interfaces2.GetAddress(1), port); // Target: 10.1.2.2
+    UdpEchoClientHelper echoClient(topo.GetAddress("n2", "net2"), port); // Target: 10.1.2.2
     echoClient.SetAttribute("MaxPackets", UintegerValue(10)); // Increased packets to observe failure
     echoClient.SetAttribute("Interval", TimeValue(Seconds(1.0)));
     echoClient.SetAttribute("PacketSize", UintegerValue(1024));
-    ApplicationContainer clientApps = echoClient.Install(n0);
-    clientApps.Start(Seconds(2.0));
-    clientApps.Stop(Seconds(10.0));
-
-    // --- Q3: Schedule Link Failure at t=4 seconds (Verification) ---
-    // We get the device on n0 corresponding to Network 3 (from link3Devices, not interfaces3).
-    Ptr<NetDevice> n0_net3_device = link3Devices.Get(0); 
-    Simulator::Schedule(Seconds(4.0), &SetLinkDown, n0_net3_device); 
-
+    if (topo.IsLocal(n0)) {
+        ApplicationContainer clientApps = echoClient.Install(n0);
+        clientApps.Start(Seconds(2.0));
+        clientApps.Stop(Seconds(10.0));
+    }
 
     // --- NetAnim Configuration ---
-    AnimationInterface anim("scratch/router-static-routing.xml");
-
-    // Set node descriptions (Q1 Verification)
-    anim.UpdateNodeDescription(n0, "HQ\\n10.1.1.1 | 10.1.3.1");
-    anim.UpdateNodeDescription(n1, "Branch\\n10.1.1.2 | 10.1.2.1");
-    anim.UpdateNodeDescription(n2, "DC\\n10.1.2.2 | 10.1.3.2");
-
-    // Set node colors
-    anim.UpdateNodeColor(n0, 0, 255, 0);   // Green for HQ
-    anim.UpdateNodeColor(n1, 255, 255, 0); // Yellow for Branch
-    anim.UpdateNodeColor(n2, 0, 0, 255);   // Blue for DC
+    // Packets are only animated inside [animStart, animStop]; metadata is opt-in.
+    // NetAnim sees a single process only, so distributed runs go without it.
+    bool animate = cfg.anim && cfg.systems == 1;
+    std::unique_ptr<AnimationInterface> anim;
+    if (animate) {
+        anim.reset(new AnimationInterface("scratch/router-static-routing.xml"));
+        anim->SetStartTime(Seconds(cfg.animStart));
+        anim->SetStopTime(Seconds(cfg.animStop > 0 ? cfg.animStop : cfg.simTime));
+        anim->EnablePacketMetadata(cfg.animMetadata);
+
+        // Set node descriptions (Q1 Verification)
+        anim->UpdateNodeDescription(n0, Describe(topo, "HQ", "n0", "net1", "net3"));
+        anim->UpdateNodeDescription(n1, Describe(topo, "Branch", "n1", "net1", "net2"));
+        anim->UpdateNodeDescription(n2, Describe(topo, "DC", "n2", "net2", "net3"));
+
+        // Set node colors
+        anim->UpdateNodeColor(n0, 0, 255, 0);   // Green for HQ
+        anim->UpdateNodeColor(n1, 255, 255, 0); // Yellow for Branch
+        anim->UpdateNodeColor(n2, 0, 0, 255);   // Blue for DC
+    }
 
-    // Enable PCAP tracing on all devices
-    p2p.EnablePcapAll("scratch/router-static-routing");
+    // PCAP: one buffered capture of every local device, filtered and sampled
+    PacketTracer pcap;
+    if (cfg.pcap) {
+        pcap.SetSampling(cfg.pcapSample);
+        pcap.SetSnaplen(cfg.pcapSnaplen);
+        pcap.SetDscpFilter(cfg.pcapDscp);
+        if (!cfg.pcapFlow.empty()) {
+            ApplyFlowFilter(pcap, cfg.pcapFlow);
+        }
+        pcap.Open("scratch/router-static-routing" + suffix + ".pcap");
+        for (uint32_t l = 0; l < topo.GetNLinks(); ++l)
+        {
+            NetDeviceContainer devices = topo.GetLinkDevices(topo.GetLinkName(l));
+            for (uint32_t side = 0; side < devices.GetN(); ++side)
+            {
+                if (topo.IsLocal(devices.Get(side)->GetNode())) {
+                    pcap.Install(NetDeviceContainer(devices.Get(side)));
+                }
+            }
+        }
+    }
 
     // Run simulation
-    Simulator::Stop(Seconds(11.0));
+    Simulator::Stop(Seconds(cfg.simTime));
     Simulator::Run();
+    pcap.Close();
+    anim.reset();
     Simulator::Destroy();
 
     std::cout << "\n=== Simulation Complete ===\n";
-    std::cout << "Animation trace saved to: scratch/router-static-routing.xml\n";
-    std::cout << "Routing tables saved to: scratch/router-static-routing.routes\n";
-    std::cout << "PCAP traces saved to: scratch/router-static-routing-*.pcap\n";
+    std::cout << "Link-state: " << linkState.GetSpfRuns() << " SPF runs, " << linkState.GetNodesRecomputed()
+              << " router recomputations, " << linkState.GetRouteChanges() << " route changes\n";
+    if (animate) {
+        std::cout << "Animation trace saved to: scratch/router-static-routing.xml\n";
+    }
+    std::cout << "Routing tables saved to: scratch/router-static-routing" << suffix << ".routes\n";
+    if (cfg.pcap) {
+        std::cout << "PCAP trace saved to: scratch/router-static-routing" << suffix << ".pcap (" << pcap.GetWritten()
+                  << " of " << pcap.GetMatched() << " matching packets)\n";
+    }
+    return true;
+}
+
+int
+main(int argc, char* argv[])
+{
+    RouterConfig cfg;
+    uint32_t runs = 1;
+    std::string output = "scratch/router-convergence.csv";
+    double maxRecoverMs = 0.0;
+    bool distributed = false;
+    std::string scheduler = "map";
+    std::string golden;
+    bool goldenRecord = false;
+
+    CommandLine cmd;
+    cmd.AddValue("topology", "Topology file (needs n0/n1/n2 and links net1/net2/net3)", cfg.topologyFile);
+    cmd.AddValue("fib", "Route through a longest-prefix-match trie FIB instead of static routing", cfg.useFib);
+    cmd.AddValue("fibRoutes", "Route file bulk-loaded into the HQ FIB ('<prefix>/<len> <nextHop> <if> [metric]' lines)", cfg.fibRoutes);
+    cmd.AddValue("bfdInterval", "BFD hello interval (ms)", cfg.bfdInterval);
+    cmd.AddValue("bfdMultiplier", "BFD detection multiplier (missed hellos)", cfg.bfdMultiplier);
+    cmd.AddValue("pcap", "Write the PCAP capture", cfg.pcap);
+    cmd.AddValue("pcapSample", "PCAP: keep 1 in N matching packets", cfg.pcapSample);
+    cmd.AddValue("pcapSnaplen", "PCAP: bytes kept per packet (e.g. 64 for headers only)", cfg.pcapSnaplen);
+    cmd.AddValue("pcapDscp", "PCAP: only this DSCP (-1 = any)", cfg.pcapDscp);
+    cmd.AddValue("pcapFlow", "PCAP: only this flow, <src>><dst>[:port] ('*' = any address)", cfg.pcapFlow);
+    cmd.AddValue("anim", "Write the NetAnim trace", cfg.anim);
+    cmd.AddValue("animStart", "NetAnim: start of the packet window (s)", cfg.animStart);
+    cmd.AddValue("animStop", "NetAnim: end of the packet window (s, 0 = end)", cfg.animStop);
+    cmd.AddValue("animMetadata", "NetAnim: include packet metadata", cfg.animMetadata);
+    cmd.AddValue("failures", "Link cuts as <link>@<seconds>[,...]", cfg.failures);
+    cmd.AddValue("simTime", "Total simulation time (s)", cfg.simTime);
+    cmd.AddValue("run", "RNG run number (first run in benchmark mode)", cfg.run);
+    cmd.AddValue("benchmark", "Headless convergence benchmark with a high-rate probe", cfg.benchmark);
+    cmd.AddValue("probeInterval", "Benchmark probe interval (ms)", cfg.probeInterval);
+    cmd.AddValue("probeSize", "Benchmark probe size (bytes)", cfg.probeSize);
+    cmd.AddValue("runs", "Benchmark runs, each with the next RNG run number", runs);
+    cmd.AddValue("output", "Benchmark CSV summary", output);
+    cmd.AddValue("maxRecoverMs", "Benchmark fails (exit 1) if any cut takes longer to recover; 0 = no gate", maxRecoverMs);
+    cmd.AddValue("distributed", "One process per site (needs ns-3 with MPI; run under mpirun)", distributed);
+    cmd.AddValue("scheduler", "Event scheduler: map, list, heap, calendar, priority or radix", scheduler);
+    cmd.AddValue("golden", "Benchmark gated on the bands in this golden file (exit 1 on failure)", golden);
+    cmd.AddValue("goldenRecord", "Record the golden bands from this run instead of checking them", goldenRecord);
+    cmd.Parse(argc, argv);
+
+    SelectScheduler(scheduler);
+    NS_ABORT_MSG_IF(cfg.bfdInterval <= 0, "--bfdInterval must be positive");
+    NS_ABORT_MSG_IF(cfg.probeInterval <= 0, "--probeInterval must be positive");
+    NS_ABORT_MSG_IF(!golden.empty() && distributed, "--golden needs a single-process run");
+    NS_ABORT_MSG_IF(distributed && runs > 1, "--distributed runs a single simulation (--runs=1)");
+    std::unique_ptr<RegressionGate> gate;
+    if (!golden.empty()) {
+        LogComponentDisableAll(LOG_LEVEL_ALL);
+        cfg.benchmark = true;
+        gate.reset(new RegressionGate("router", golden, goldenRecord));
+    }
+
+    if (distributed) {
+#ifdef NS3_MPI
+        GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::DistributedSimulatorImpl"));
+        MpiInterface::Enable(&argc, &argv);
+        cfg.systems = MpiInterface::GetSize();
+        cfg.systemId = MpiInterface::GetSystemId();
+#else
+        NS_FATAL_ERROR("--distributed needs ns-3 configured with --enable-mpi");
+#endif
+    }
 
-    return 0;
+    std::vector<ConvergenceEvent> events;
+    bool reporter = true;
+    uint32_t firstRun = cfg.run;
+    for (uint32_t i = 0; i < (cfg.benchmark ? runs : 1); ++i)
+    {
+        cfg.run = firstRun + i;
+        if (gate) {
+            gate->Watch();
+        }
+        reporter = RunRouterScenario(cfg, cfg.benchmark ? &events : 0);
+    }
+#ifdef NS3_MPI
+    if (distributed) {
+        MpiInterface::Disable();
+    }
+#endif
+    if (!cfg.benchmark || !reporter) {
+        return 0; // The partition holding the probe sink writes the summary
+    }
+
+    std::ofstream out(output.c_str());
+    NS_ABORT_MSG_IF(!out.is_open(), "Benchmark: cannot open " << output);
+    out << "run,link,failTime,probes,lost,reordered,lossWindowMs,recoverMs\n";
+    bool pass = true;
+    double worstRecoverMs = 0.0, sumRecoverMs = 0.0;
+    for (const ConvergenceEvent& e : events)
+    {
+        out << e.run << "," << e.link << "," << e.failTime << "," << e.probes << "," << e.lost << ","
+            << e.reordered << "," << e.lossWindowMs << "," << e.recoverMs << "\n";
+        bool recovered = e.recoverMs >= 0;
+        worstRecoverMs = recovered ? std::max(worstRecoverMs, e.recoverMs) : worstRecoverMs;
+        sumRecoverMs += recovered ? e.recoverMs : 0.0;
+        pass = pass && recovered && (maxRecoverMs <= 0 || e.recoverMs <= maxRecoverMs);
+    }
+
+    std::cout << "Convergence: " << events.size() << " cuts over " << runs << " runs, mean recovery "
+              << (events.empty() ? 0.0 : sumRecoverMs / events.size()) << " ms, worst " << worstRecoverMs
+              << " ms -> " << output << (pass ? "" : " [FAIL]") << "\n";
+    if (gate) {
+        // Regression gate: failover loss window and recovery of the worst cut, events and wall time
+        double worstLossWindowMs = 0.0;
+        uint32_t lost = 0;
+        for (const ConvergenceEvent& e : events)
+        {
+            worstLossWindowMs = std::max(worstLossWindowMs, e.lossWindowMs);
+            lost += e.lost;
+        }
+        gate->Check("lossWindowMs", worstLossWindowMs, std::max(5.0, worstLossWindowMs * 0.2));
+        gate->Check("recoverMs", worstRecoverMs, std::max(5.0, worstRecoverMs * 0.2));
+        gate->Check("lostProbes", lost, std::max(5.0, lost * 0.2));
+        gate->Check("unrecovered", events.size() - std::count_if(events.begin(), events.end(),
+            [](const ConvergenceEvent& e) { return e.recoverMs >= 0; }), 0.0);
+        pass = gate->Finish() && pass;
+    }
+    return pass ? 0 : 1;
 }
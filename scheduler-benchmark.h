@@ -0,0 +1,280 @@
+/*
+ * Event scheduler selection and a scaling benchmark harness for the exercise
+ * scripts.
+ *
+ *   SelectScheduler     picks the simulator's event queue by short name:
+ *                       map (ns-3 default), list, heap, calendar, priority or radix
+ *   RadixHeapScheduler  monotone radix heap over the event timestamps, with all
+ *                       events kept in per-bucket vectors that are reused for the
+ *                       whole run (a pooled event store: no allocation per event
+ *                       once the buckets have grown)
+ *   RunSchedulerBenchmark
+ *                       runs one scenario per scheduler x nodes x flows case, each
+ *                       in its own forked process, and reports events processed,
+ *                       events/s, wall time and peak RSS per case
+ *
+ * The radix heap relies on the simulator never scheduling into the past: every
+ * inserted timestamp is at least the last one removed, which holds for all
+ * events ns-3 schedules.
+ */
+
+#ifndef SCHEDULER_BENCHMARK_H
+#define SCHEDULER_BENCHMARK_H
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+class RadixHeapScheduler : public Scheduler
+{
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::RadixHeapScheduler")
+            .SetParent<Scheduler>()
+            .SetGroupName("Core")
+            .AddConstructor<RadixHeapScheduler>();
+        return tid;
+    }
+
+    RadixHeapScheduler() : m_last(0), m_head(0), m_size(0) {}
+
+    virtual void Insert(const Event& ev) override {
+        NS_ABORT_MSG_IF(ev.key.m_ts < m_last, "RadixHeapScheduler: event scheduled in the past");
+        // Bucket 0 stays in uid order: anything appended to it is newer than its contents
+        m_buckets[Bucket(ev.key.m_ts)].push_back(ev);
+        ++m_size;
+    }
+
+    virtual bool IsEmpty(void) const override { return m_size == 0; }
+
+    virtual Event PeekNext(void) const override {
+        NS_ABORT_MSG_IF(m_size == 0, "RadixHeapScheduler: PeekNext on an empty queue");
+        if (m_head < m_buckets[0].size()) {
+            return m_buckets[0][m_head];
+        }
+        // Not redistributed yet: that would move m_last past the current time
+        const std::vector<Event>& bucket = m_buckets[FirstBucket()];
+        return *std::min_element(bucket.begin(), bucket.end(), &RadixHeapScheduler::Earlier);
+    }
+
+    virtual Event RemoveNext(void) override {
+        NS_ABORT_MSG_IF(m_size == 0, "RadixHeapScheduler: RemoveNext on an empty queue");
+        if (m_head == m_buckets[0].size()) {
+            Refill();
+        }
+        --m_size;
+        return m_buckets[0][m_head++];
+    }
+
+    virtual void Remove(const Event& ev) override {
+        std::vector<Event>& bucket = m_buckets[Bucket(ev.key.m_ts)];
+        std::vector<Event>::iterator first = bucket.begin() + (&bucket == &m_buckets[0] ? m_head : 0);
+        std::vector<Event>::iterator it = std::find_if(first, bucket.end(),
+            [&ev](const Event& e) { return e.key.m_uid == ev.key.m_uid; });
+        NS_ABORT_MSG_IF(it == bucket.end(), "RadixHeapScheduler: removing an unknown event");
+        bucket.erase(it);
+        --m_size;
+    }
+
+private:
+    static constexpr uint32_t BUCKETS = 65;     // Bucket b > 0 differs from m_last first in bit b-1
+
+    static bool Earlier(const Event& x, const Event& y)
+    {
+        return x.key.m_ts < y.key.m_ts || (x.key.m_ts == y.key.m_ts && x.key.m_uid < y.key.m_uid);
+    }
+
+    uint32_t Bucket(uint64_t ts) const
+    {
+        return ts == m_last ? 0 : 64 - __builtin_clzll(ts ^ m_last);
+    }
+
+    uint32_t FirstBucket() const
+    {
+        uint32_t b = 1;
+        while (m_buckets[b].empty())
+        {
+            ++b;
+        }
+        return b;
+    }
+
+    // Bucket 0 is drained: redistribute the smallest non-empty bucket around its
+    // earliest timestamp, which becomes m_last (the time of the event removed next)
+    void Refill()
+    {
+        m_buckets[0].clear();   // Capacity is kept for the next batch
+        m_head = 0;
+        std::vector<Event>& source = m_buckets[FirstBucket()];
+        m_last = std::min_element(source.begin(), source.end(), &RadixHeapScheduler::Earlier)->key.m_ts;
+        for (const Event& ev : source)
+        {
+            m_buckets[Bucket(ev.key.m_ts)].push_back(ev);     // Always a lower bucket than the source
+        }
+        source.clear();
+        std::sort(m_buckets[0].begin(), m_buckets[0].end(), &RadixHeapScheduler::Earlier);
+    }
+
+    std::vector<Event> m_buckets[BUCKETS];
+    uint64_t m_last;        // Timestamp of the last removed event; nothing is inserted before it
+    size_t m_head;          // Next event of bucket 0; removed events stay until it drains
+    uint64_t m_size;
+};
+
+// Makes every simulator created from now on (including after Simulator::Destroy)
+// use the named scheduler; call before anything touches the Simulator
+inline void SelectScheduler(const std::string& name)
+{
+    static const char* const names[][2] = {
+        {"map", "ns3::MapScheduler"},
+        {"list", "ns3::ListScheduler"},
+        {"heap", "ns3::HeapScheduler"},
+        {"calendar", "ns3::CalendarScheduler"},
+        {"priority", "ns3::PriorityQueueScheduler"},
+        {"radix", "ns3::RadixHeapScheduler"},
+    };
+    RadixHeapScheduler::GetTypeId();    // Registers the TypeId before it is looked up by name
+    for (const auto& entry : names)
+    {
+        if (name == entry[0]) {
+            GlobalValue::Bind("SchedulerType", StringValue(entry[1]));
+            return;
+        }
+    }
+    NS_ABORT_MSG("Unknown --scheduler '" << name << "' (map, list, heap, calendar, priority or radix)");
+}
+
+struct SchedulerBenchmarkCase
+{
+    std::string scheduler;
+    uint32_t nodes = 0;
+    uint32_t flows = 0;
+};
+
+struct SchedulerBenchmarkResult
+{
+    uint64_t events = 0;
+    double wallSeconds = 0.0;
+    long peakRssKb = 0;
+    bool ok = false;
+};
+
+// Cartesian product of comma-separated scheduler names, node counts and flow counts
+inline std::vector<SchedulerBenchmarkCase> ExpandSchedulerBenchmark(const std::string& schedulers,
+                                                                   const std::string& nodes,
+                                                                   const std::string& flows)
+{
+    std::vector<std::string> schedulerList, nodeList, flowList;
+    for (auto list : {std::make_pair(&schedulers, &schedulerList), std::make_pair(&nodes, &nodeList),
+                      std::make_pair(&flows, &flowList)})
+    {
+        std::istringstream in(*list.first);
+        std::string item;
+        while (std::getline(in, item, ','))
+        {
+            if (!item.empty()) {
+                list.second->push_back(item);
+            }
+        }
+        NS_ABORT_MSG_IF(list.second->empty(), "Benchmark: empty list '" << *list.first << "'");
+    }
+
+    std::vector<SchedulerBenchmarkCase> cases;
+    for (const std::string& s : schedulerList)
+    for (const std::string& n : nodeList)
+    for (const std::string& f : flowList)
+    {
+        SchedulerBenchmarkCase c;
+        c.scheduler = s;
+        c.nodes = std::stoul(n);
+        c.flows = std::stoul(f);
+        cases.push_back(c);
+    }
+    return cases;
+}
+
+// Event count of the simulator being destroyed, captured before it goes away
+inline void RecordSchedulerBenchmarkEvents(uint64_t* events)
+{
+    *events = Simulator::GetEventCount();
+}
+
+// Runs scenario(case) for every case, one at a time so the timings do not
+// compete for cores, each in a fresh forked process so peak RSS is per case.
+// The scenario must run and destroy exactly one simulation.
+template <typename Scenario>
+void RunSchedulerBenchmark(const std::string& name, const std::vector<SchedulerBenchmarkCase>& cases,
+                           Scenario scenario, const std::string& output)
+{
+    std::vector<SchedulerBenchmarkResult> results(cases.size());
+    for (uint32_t i = 0; i < cases.size(); ++i)
+    {
+        int fds[2];
+        NS_ABORT_MSG_IF(pipe(fds) != 0, "Benchmark: pipe() failed");
+        std::cout.flush();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        pid_t pid = fork();
+        NS_ABORT_MSG_IF(pid < 0, "Benchmark: fork() failed");
+        if (pid == 0) {
+            close(fds[0]);
+            uint64_t events = 0;
+            SelectScheduler(cases[i].scheduler);
+            Simulator::ScheduleDestroy(&RecordSchedulerBenchmarkEvents, &events);
+            scenario(cases[i]);
+            ssize_t written = write(fds[1], &events, sizeof(events));
+            close(fds[1]);
+            _exit(written == sizeof(events) ? 0 : 1);
+        }
+        close(fds[1]);
+
+        SchedulerBenchmarkResult& r = results[i];
+        ssize_t n = read(fds[0], &r.events, sizeof(r.events));
+        close(fds[0]);
+        int status = 0;
+        struct rusage usage;
+        NS_ABORT_MSG_IF(wait4(pid, &status, 0, &usage) != pid, "Benchmark: wait4() failed");
+        r.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        r.peakRssKb = usage.ru_maxrss;     // Kilobytes on Linux
+        r.ok = n == sizeof(r.events) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+        std::cout << name << " " << std::setw(8) << cases[i].scheduler << " nodes " << std::setw(5) << cases[i].nodes
+                  << " flows " << std::setw(5) << cases[i].flows << ": ";
+        if (r.ok) {
+            std::cout << r.events << " events, " << std::fixed << std::setprecision(2) << r.wallSeconds << " s, "
+                      << std::setprecision(0) << r.events / r.wallSeconds << " events/s, peak RSS "
+                      << r.peakRssKb / 1024 << " MB\n" << std::defaultfloat;
+        } else {
+            std::cout << "FAILED\n";
+        }
+    }
+
+    std::ofstream out(output.c_str());
+    out << "scenario,scheduler,nodes,flows,events,wallSeconds,eventsPerSecond,peakRssKb\n";
+    for (uint32_t i = 0; i < cases.size(); ++i)
+    {
+        if (!results[i].ok) {
+            continue;
+        }
+        out << name << "," << cases[i].scheduler << "," << cases[i].nodes << "," << cases[i].flows << ","
+            << results[i].events << "," << results[i].wallSeconds << ","
+            << results[i].events / results[i].wallSeconds << "," << results[i].peakRssKb << "\n";
+    }
+    std::cout << "Benchmark: results written to " << output << "\n";
+}
+
+} // namespace ns3
+
+#endif /* SCHEDULER_BENCHMARK_H */
@@ -0,0 +1,422 @@
+/*
+ * Realistic traffic sources for the exercise scripts, replacing constant-rate
+ * OnOff applications. One TrafficGenerator per node drives any number of flows,
+ * each on its own socket (so every flow has its own 5-tuple):
+ *
+ *   VOIP   packets every 20 ms during exponential talk spurts, silent in between
+ *          (Brady on/off model, mean 1.0 s talk / 1.35 s silence)
+ *   VIDEO  frames at 25 fps in 12-frame GOPs: an I frame five times the size of a
+ *          P frame, frame sizes varying by +-20 %, each frame sent as a
+ *          back-to-back burst of packets
+ *   BULK   a TCP transfer that keeps the socket's send buffer full
+ *   TRACE  replays "<interArrivalUs> <size> <dscp>" lines ('#' comments) from a
+ *          TrafficTrace; the file is memory-mapped and parsed one record at a time
+ *
+ * Flows that start at the same time form a batch that is opened by a single
+ * event, so thousands of flows cost one event per batch to start. Flows stop at
+ * their stop time without a separate event.
+ */
+
+#ifndef TRAFFIC_GENERATOR_H
+#define TRAFFIC_GENERATOR_H
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+// Read-only memory mapping of a flow trace, shared by every flow that replays it
+class TrafficTrace
+{
+public:
+    struct Record
+    {
+        Time interArrival;
+        uint32_t size;
+        uint8_t dscp;
+    };
+
+    explicit TrafficTrace(const std::string& path)
+    : m_data(0), m_size(0)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        NS_ABORT_MSG_IF(fd < 0, "TrafficTrace: cannot open " << path);
+        struct stat st;
+        NS_ABORT_MSG_IF(fstat(fd, &st) != 0, "TrafficTrace: cannot stat " << path);
+        m_size = st.st_size;
+        if (m_size > 0) {
+            void* data = mmap(0, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            NS_ABORT_MSG_IF(data == MAP_FAILED, "TrafficTrace: cannot map " << path);
+            madvise(data, m_size, MADV_SEQUENTIAL);
+            m_data = static_cast<const char*>(data);
+        }
+        close(fd);
+    }
+
+    ~TrafficTrace()
+    {
+        if (m_data) {
+            munmap(const_cast<char*>(m_data), m_size);
+        }
+    }
+
+    TrafficTrace(const TrafficTrace&) = delete;
+    TrafficTrace& operator=(const TrafficTrace&) = delete;
+
+    // Parses the record at or after cursor and advances it; false at the end of the file
+    bool Next(size_t& cursor, Record& record) const
+    {
+        while (cursor < m_size)
+        {
+            const char* p = m_data + cursor;
+            const char* end = m_data + m_size;
+            const char* eol = std::find(p, end, '\n');
+            const char* line = p;
+            cursor = (eol - m_data) + 1;
+
+            uint64_t fields[3];
+            uint32_t n = 0;
+            while (p < eol && *p != '#' && n < 3)
+            {
+                if (*p < '0' || *p > '9') {
+                    ++p;
+                    continue;
+                }
+                uint64_t v = 0;
+                for (; p < eol && *p >= '0' && *p <= '9'; ++p)
+                {
+                    v = v * 10 + (*p - '0');
+                }
+                fields[n++] = v;
+            }
+            if (n == 0) {
+                continue; // Blank or comment line
+            }
+            NS_ABORT_MSG_IF(n != 3 || fields[2] > 63, "TrafficTrace: bad record '" << std::string(line, eol) << "'");
+            record.interArrival = MicroSeconds(fields[0]);
+            record.size = static_cast<uint32_t>(fields[1]);
+            record.dscp = static_cast<uint8_t>(fields[2]);
+            return true;
+        }
+        return false;
+    }
+
+private:
+    const char* m_data;
+    size_t m_size;
+};
+
+enum class TrafficModel
+{
+    VOIP,
+    VIDEO,
+    BULK,
+    TRACE
+};
+
+struct TrafficFlowSpec
+{
+    TrafficModel model = TrafficModel::VOIP;
+    Address remote;
+    uint8_t dscp = 0;                       // VOIP/VIDEO/BULK; TRACE takes it per record
+    Time start = Seconds(1.0);
+    Time stop = Time::Max();
+    uint32_t packetSize = 200;              // VOIP packet, VIDEO fragment, BULK write size
+    DataRate rate = DataRate("1Mbps");      // VIDEO mean rate
+    std::shared_ptr<const TrafficTrace> trace;
+    bool loop = true;                       // TRACE: start over at the end of the file
+};
+
+class TrafficGenerator : public Application
+{
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::TrafficGenerator")
+            .SetParent<Application>()
+            .SetGroupName("Applications")
+            .AddConstructor<TrafficGenerator>()
+            .AddAttribute("EnableSeqTsSizeHeader", "Carry a SeqTsSizeHeader in every packet (UDP models)",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&TrafficGenerator::m_seqTsSize),
+                          MakeBooleanChecker())
+            .AddTraceSource("Tx", "A packet was handed to a flow's socket",
+                            MakeTraceSourceAccessor(&TrafficGenerator::m_txTrace),
+                            "ns3::Packet::TracedCallback");
+        return tid;
+    }
+
+    TrafficGenerator()
+    : m_seqTsSize(false)
+    {
+        m_uniform = CreateObject<UniformRandomVariable>();
+        m_talk = CreateObject<ExponentialRandomVariable>();
+        m_talk->SetAttribute("Mean", DoubleValue(VOIP_TALK_MEAN));
+        m_silence = CreateObject<ExponentialRandomVariable>();
+        m_silence->SetAttribute("Mean", DoubleValue(VOIP_SILENCE_MEAN));
+    }
+
+    uint32_t AddFlow(const TrafficFlowSpec& spec)
+    {
+        NS_ABORT_MSG_IF(spec.model == TrafficModel::TRACE && !spec.trace, "TrafficGenerator: trace flow without a trace");
+        NS_ABORT_MSG_IF(spec.packetSize == 0, "TrafficGenerator: zero packet size");
+        Flow flow;
+        flow.spec = spec;
+        m_flows.push_back(flow);
+        return m_flows.size() - 1;
+    }
+
+    uint32_t GetNFlows() const { return m_flows.size(); }
+
+protected:
+    virtual void DoDispose(void) override {
+        m_flows.clear();
+        Application::DoDispose();
+    }
+
+private:
+    struct Flow
+    {
+        TrafficFlowSpec spec;
+        Ptr<Socket> socket;
+        EventId next;
+        uint32_t seq = 0;
+        uint8_t tos = 0;
+        Time talkEnd;           // VOIP: end of the current talk spurt
+        uint32_t frame = 0;     // VIDEO: position in the GOP
+        size_t cursor = 0;      // TRACE: byte offset of the next record
+    };
+
+    static constexpr double VOIP_TALK_MEAN = 1.0;       // s
+    static constexpr double VOIP_SILENCE_MEAN = 1.35;   // s
+    static constexpr double VOIP_INTERVAL = 0.020;      // s, one codec frame per packet
+    static constexpr double VIDEO_FPS = 25.0;
+    static constexpr uint32_t VIDEO_GOP = 12;
+    static constexpr double VIDEO_I_WEIGHT = 5.0;       // I frame size in P frames
+
+    virtual void StartApplication(void) override {
+        // One event per distinct start time opens the whole batch
+        m_order.resize(m_flows.size());
+        for (uint32_t i = 0; i < m_flows.size(); ++i)
+        {
+            m_order[i] = i;
+        }
+        std::stable_sort(m_order.begin(), m_order.end(),
+                         [this](uint32_t a, uint32_t b) { return m_flows[a].spec.start < m_flows[b].spec.start; });
+        for (uint32_t first = 0; first < m_order.size();)
+        {
+            uint32_t last = first;
+            while (last < m_order.size() && m_flows[m_order[last]].spec.start == m_flows[m_order[first]].spec.start)
+            {
+                ++last;
+            }
+            Time delay = std::max(m_flows[m_order[first]].spec.start - Simulator::Now(), Time(0));
+            m_batches.push_back(Simulator::Schedule(delay, &TrafficGenerator::StartBatch, this, first, last));
+            first = last;
+        }
+    }
+
+    virtual void StopApplication(void) override {
+        for (EventId& batch : m_batches)
+        {
+            batch.Cancel();
+        }
+        m_batches.clear();
+        for (Flow& f : m_flows)
+        {
+            Close(f);
+        }
+    }
+
+    void StartBatch(uint32_t first, uint32_t last)
+    {
+        for (uint32_t i = first; i < last; ++i)
+        {
+            uint32_t id = m_order[i];
+            Flow& f = m_flows[id];
+            bool tcp = f.spec.model == TrafficModel::BULK;
+            f.socket = Socket::CreateSocket(GetNode(), tcp ? TcpSocketFactory::GetTypeId() : UdpSocketFactory::GetTypeId());
+            f.socket->Bind();
+            f.socket->Connect(f.spec.remote);
+            f.tos = f.spec.dscp << 2;
+            f.socket->SetIpTos(f.tos);
+
+            switch (f.spec.model)
+            {
+            case TrafficModel::VOIP:
+                // Random phase so a batch of calls does not send in lockstep
+                f.talkEnd = Simulator::Now() + Seconds(m_talk->GetValue());
+                f.next = Simulator::Schedule(Seconds(m_uniform->GetValue(0.0, VOIP_INTERVAL)), &TrafficGenerator::SendVoip, this, id);
+                break;
+            case TrafficModel::VIDEO:
+                f.frame = m_uniform->GetInteger(0, VIDEO_GOP - 1);
+                f.next = Simulator::Schedule(Seconds(m_uniform->GetValue(0.0, 1.0 / VIDEO_FPS)), &TrafficGenerator::SendFrame, this, id);
+                break;
+            case TrafficModel::BULK:
+                f.socket->SetSendCallback(MakeBoundCallback(&TrafficGenerator::BulkReady, this, id));
+                f.socket->SetConnectCallback(MakeBoundCallback(&TrafficGenerator::BulkConnected, this, id),
+                                             MakeNullCallback<void, Ptr<Socket> >());
+                break;
+            case TrafficModel::TRACE:
+                SendTrace(id);
+                break;
+            }
+        }
+    }
+
+    void SendVoip(uint32_t id)
+    {
+        Flow& f = m_flows[id];
+        if (Stopped(f)) {
+            return;
+        }
+        Time now = Simulator::Now();
+        if (now >= f.talkEnd) {
+            // Spurt over: stay silent, then start the next spurt
+            Time silence = Seconds(m_silence->GetValue());
+            f.talkEnd = now + silence + Seconds(m_talk->GetValue());
+            f.next = Simulator::Schedule(silence, &TrafficGenerator::SendVoip, this, id);
+            return;
+        }
+        Send(f, f.spec.packetSize);
+        f.next = Simulator::Schedule(Seconds(VOIP_INTERVAL), &TrafficGenerator::SendVoip, this, id);
+    }
+
+    void SendFrame(uint32_t id)
+    {
+        Flow& f = m_flows[id];
+        if (Stopped(f)) {
+            return;
+        }
+        double gopBytes = f.spec.rate.GetBitRate() / 8.0 * VIDEO_GOP / VIDEO_FPS;
+        double pFrame = gopBytes / (VIDEO_I_WEIGHT + VIDEO_GOP - 1);
+        double frameBytes = (f.frame == 0 ? VIDEO_I_WEIGHT : 1.0) * pFrame * m_uniform->GetValue(0.8, 1.2);
+        for (uint32_t left = static_cast<uint32_t>(frameBytes); left > 0;)
+        {
+            uint32_t size = std::min(left, f.spec.packetSize);
+            Send(f, size);
+            left -= size;
+        }
+        f.frame = (f.frame + 1) % VIDEO_GOP;
+        f.next = Simulator::Schedule(Seconds(1.0 / VIDEO_FPS), &TrafficGenerator::SendFrame, this, id);
+    }
+
+    void SendTrace(uint32_t id)
+    {
+        Flow& f = m_flows[id];
+        if (Stopped(f)) {
+            return;
+        }
+        TrafficTrace::Record record;
+        if (!f.spec.trace->Next(f.cursor, record)) {
+            f.cursor = 0;
+            if (!f.spec.loop || !f.spec.trace->Next(f.cursor, record)) {
+                Close(f);
+                return;
+            }
+        }
+        if (record.dscp << 2 != f.tos) {
+            f.tos = record.dscp << 2;
+            f.socket->SetIpTos(f.tos);
+        }
+        f.next = Simulator::Schedule(record.interArrival, &TrafficGenerator::SendTracePacket, this, id, record.size);
+    }
+
+    void SendTracePacket(uint32_t id, uint32_t size)
+    {
+        Flow& f = m_flows[id];
+        if (Stopped(f)) {
+            return;
+        }
+        Send(f, size);
+        SendTrace(id);
+    }
+
+    static void BulkConnected(TrafficGenerator* self, uint32_t id, Ptr<Socket> socket)
+    {
+        self->FillBulk(id);
+    }
+
+    static void BulkReady(TrafficGenerator* self, uint32_t id, Ptr<Socket> socket, uint32_t available)
+    {
+        self->FillBulk(id);
+    }
+
+    // Writes as long as the send buffer takes whole chunks
+    void FillBulk(uint32_t id)
+    {
+        Flow& f = m_flows[id];
+        while (!Stopped(f) && f.socket->GetTxAvailable() >= f.spec.packetSize)
+        {
+            if (!Send(f, f.spec.packetSize)) {
+                break;
+            }
+        }
+    }
+
+    bool Send(Flow& f, uint32_t size)
+    {
+        Ptr<Packet> packet;
+        if (m_seqTsSize) {
+            SeqTsSizeHeader header;
+            header.SetSeq(f.seq++);
+            header.SetSize(size);
+            uint32_t headerSize = header.GetSerializedSize();
+            packet = Create<Packet>(size > headerSize ? size - headerSize : 0);
+            packet->AddHeader(header);
+        } else {
+            packet = Create<Packet>(size);
+        }
+        if (f.socket->Send(packet) < 0) {
+            return false;
+        }
+        m_txTrace(packet);
+        return true;
+    }
+
+    // Closes the flow once its stop time has passed
+    bool Stopped(Flow& f)
+    {
+        if (!f.socket) {
+            return true;
+        }
+        if (Simulator::Now() < f.spec.stop) {
+            return false;
+        }
+        Close(f);
+        return true;
+    }
+
+    void Close(Flow& f)
+    {
+        f.next.Cancel();
+        if (f.socket) {
+            f.socket->Close();
+            f.socket = 0;
+        }
+    }
+
+    bool m_seqTsSize;
+    std::vector<Flow> m_flows;
+    std::vector<uint32_t> m_order;      // Flow ids sorted by start time
+    std::vector<EventId> m_batches;
+    Ptr<UniformRandomVariable> m_uniform;
+    Ptr<ExponentialRandomVariable> m_talk;
+    Ptr<ExponentialRandomVariable> m_silence;
+    TracedCallback<Ptr<const Packet> > m_txTrace;
+};
+
+} // namespace ns3
+
+#endif /* TRAFFIC_GENERATOR_H */
@@ -0,0 +1,108 @@
+/*
+ * UDP sink for the high-rate scenarios that only counts: packets are read,
+ * peeked and dropped, never re-assembled or copied the way PacketSink does to
+ * support stream sockets. Optionally peeks a SeqTsSizeHeader for
+ * RxWithSeqTsSize, like PacketSink.
+ */
+
+#ifndef UDP_COUNT_SINK_H
+#define UDP_COUNT_SINK_H
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+namespace ns3 {
+
+class UdpCountSink : public Application
+{
+public:
+    static TypeId GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::UdpCountSink")
+            .SetParent<Application>()
+            .SetGroupName("Applications")
+            .AddConstructor<UdpCountSink>()
+            .AddAttribute("Local", "Address to bind to",
+                          AddressValue(),
+                          MakeAddressAccessor(&UdpCountSink::m_local),
+                          MakeAddressChecker())
+            .AddAttribute("EnableSeqTsSizeHeader", "Peek a SeqTsSizeHeader and fire RxWithSeqTsSize",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&UdpCountSink::m_seqTsSize),
+                          MakeBooleanChecker())
+            .AddTraceSource("Rx", "A packet has been received",
+                            MakeTraceSourceAccessor(&UdpCountSink::m_rxTrace),
+                            "ns3::Packet::AddressTracedCallback")
+            .AddTraceSource("RxWithSeqTsSize", "A packet with SeqTsSize header has been received",
+                            MakeTraceSourceAccessor(&UdpCountSink::m_rxTraceWithSeqTsSize),
+                            "ns3::PacketSink::SeqTsSizeCallback");
+        return tid;
+    }
+
+    UdpCountSink() : m_seqTsSize(false), m_totalRx(0), m_packets(0) {}
+
+    // A sink on node listening on local, like PacketSinkHelper("ns3::UdpSocketFactory", local)
+    static ApplicationContainer Install(Ptr<Node> node, const Address& local, bool seqTsSize = false)
+    {
+        Ptr<UdpCountSink> sink = CreateObject<UdpCountSink>();
+        sink->SetAttribute("Local", AddressValue(local));
+        sink->SetAttribute("EnableSeqTsSizeHeader", BooleanValue(seqTsSize));
+        node->AddApplication(sink);
+        return ApplicationContainer(sink);
+    }
+
+    uint64_t GetTotalRx() const { return m_totalRx; }
+    uint64_t GetReceivedPackets() const { return m_packets; }
+
+protected:
+    virtual void DoDispose(void) override {
+        m_socket = 0;
+        Application::DoDispose();
+    }
+
+private:
+    virtual void StartApplication(void) override {
+        if (!m_socket) {
+            m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+            NS_ABORT_MSG_IF(m_socket->Bind(m_local) != 0, "UdpCountSink: bind failed");
+        }
+        m_socket->SetRecvCallback(MakeCallback(&UdpCountSink::HandleRead, this));
+    }
+
+    virtual void StopApplication(void) override {
+        if (m_socket) {
+            m_socket->Close();
+            m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket> >());
+        }
+    }
+
+    void HandleRead(Ptr<Socket> socket)
+    {
+        Ptr<Packet> packet;
+        Address from;
+        while ((packet = socket->RecvFrom(from)))
+        {
+            m_totalRx += packet->GetSize();
+            ++m_packets;
+            m_rxTrace(packet, from);
+            if (m_seqTsSize && !m_rxTraceWithSeqTsSize.IsEmpty()) {
+                SeqTsSizeHeader header;
+                packet->PeekHeader(header);
+                m_rxTraceWithSeqTsSize(packet, from, m_local, header);
+            }
+        }
+    }
+
+    Address m_local;
+    bool m_seqTsSize;
+    Ptr<Socket> m_socket;
+    uint64_t m_totalRx;
+    uint64_t m_packets;
+    TracedCallback<Ptr<const Packet>, const Address&> m_rxTrace;
+    TracedCallback<Ptr<const Packet>, const Address&, const Address&, const SeqTsSizeHeader&> m_rxTraceWithSeqTsSize;
+};
+
+} // namespace ns3
+
+#endif /* UDP_COUNT_SINK_H */
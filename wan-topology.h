@@ -0,0 +1,429 @@
+/*
+ * Declarative WAN topology loader shared by the exercise scripts.
+ * Replaces hand-wired NodeContainer / PointToPointHelper / Ipv4AddressHelper code
+ * and hardcoded interface indices with a line-oriented description that is
+ * applied while it is read (one pass, hash lookups only, so setup cost is linear
+ * in the number of nodes + links).
+ *
+ * Format (one statement per line, '#' starts a comment, options are key=value):
+ *
+ *   pool     <prefix/len> <linkLen>            Subnet pool for links without subnet=
+ *   defaults [rate=R] [delay=D] [queue=Np|NB] [qdisc=<TypeId>|default|none]
+ *   node     <name> [x=X y=Y] [site=S]         x/y install a constant-position mobility model
+ *   link     <name> <nodeA> <nodeB> [rate=R] [delay=D] [subnet=a.b.c.d/len]
+ *                                     [queue=Np|NB] [qdisc=<TypeId>|default|none]
+ *   route    <node> <prefix/len>|default via <link> [metric=M]
+ *
+ * The first host address of a link subnet goes to nodeA, the second to nodeB.
+ * Routes use the peer's address on <link> as next hop and the node's interface on
+ * <link> as output interface, so scripts never spell out interface indices.
+ *
+ * Distributed runs: with SetPartitioning(systems, local) every rank loads the
+ * same description and a node of site S gets system id S % systems. Links
+ * between systems become remote channels (ns-3 picks them when MPI is enabled)
+ * whose delay is the synchronisation lookahead; scripts install applications
+ * only where IsLocal() holds.
+ */
+
+#ifndef WAN_TOPOLOGY_H
+#define WAN_TOPOLOGY_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+class WanTopology
+{
+public:
+    WanTopology()
+    : m_poolNext(0), m_poolLast(0), m_poolStep(0), m_poolMask(0),
+      m_rate("100Mbps"), m_delay("2ms"), m_queue(""), m_qdisc("default"), m_lineNo(0),
+      m_systems(1), m_localSystem(0)
+    {
+        SetSubnetPool(Ipv4Address("10.0.0.0"), 8, 24);
+    }
+
+    // Stack used for every node; set before loading (e.g. to change routing helpers)
+    void SetStackHelper(const InternetStackHelper& stack) { m_stack = stack; }
+
+    // Auto-allocated link subnets are carved as /linkLen blocks out of prefix/len
+    void SetSubnetPool(Ipv4Address prefix, uint32_t len, uint32_t linkLen)
+    {
+        NS_ABORT_MSG_IF(len > linkLen || linkLen > 30, "Topology: bad subnet pool /" << len << " -> /" << linkLen);
+        m_poolMask = PrefixToMask(linkLen);
+        m_poolStep = 1u << (32 - linkLen);
+        m_poolNext = prefix.Get() & PrefixToMask(len);
+        m_poolLast = m_poolNext + (static_cast<uint64_t>(1) << (32 - len)) - m_poolStep;
+    }
+
+    // Sites are spread over 'systems' partitions, this process simulates 'local'; set before loading
+    void SetPartitioning(uint32_t systems, uint32_t local)
+    {
+        NS_ABORT_MSG_IF(systems == 0 || local >= systems, "Topology: bad partitioning " << local << "/" << systems);
+        m_systems = systems;
+        m_localSystem = local;
+    }
+
+    void LoadFile(const std::string& path)
+    {
+        std::ifstream in(path.c_str());
+        NS_ABORT_MSG_IF(!in.is_open(), "Topology: cannot open " << path);
+        Load(in);
+    }
+
+    void LoadString(const std::string& text)
+    {
+        std::istringstream in(text);
+        Load(in);
+    }
+
+    // Reads and applies statements one line at a time
+    void Load(std::istream& in)
+    {
+        std::string line;
+        std::vector<std::string> tokens;
+        while (std::getline(in, line))
+        {
+            ++m_lineNo;
+            Tokenize(line, tokens);
+            if (tokens.empty()) {
+                continue;
+            }
+            const std::string& kind = tokens[0];
+            if (kind == "node") {
+                ParseNode(tokens);
+            } else if (kind == "link") {
+                ParseLink(tokens);
+            } else if (kind == "route") {
+                ParseRoute(tokens);
+            } else if (kind == "defaults") {
+                ParseDefaults(tokens);
+            } else if (kind == "pool") {
+                ParsePool(tokens);
+            } else {
+                NS_FATAL_ERROR("Topology line " << m_lineNo << ": unknown statement '" << kind << "'");
+            }
+        }
+    }
+
+    // --- Lookups by name ---
+    Ptr<Node> GetNode(const std::string& node) const { return m_nodes.Get(NodeId(node)); }
+    const NodeContainer& GetNodes() const { return m_nodes; }
+    bool IsLocal(Ptr<Node> node) const { return node->GetSystemId() == m_localSystem; }
+    bool IsLocal(const std::string& node) const { return IsLocal(GetNode(node)); }
+    uint32_t GetNLinks() const { return m_links.size(); }
+    const std::string& GetLinkName(uint32_t link) const { return m_links[link].name; }
+    NetDeviceContainer GetLinkDevices(const std::string& link) const
+    {
+        const Link& l = m_links[LinkId(link)];
+        NetDeviceContainer devices;
+        devices.Add(l.device[0]);
+        devices.Add(l.device[1]);
+        return devices;
+    }
+    Ptr<NetDevice> GetDevice(const std::string& node, const std::string& link) const
+    {
+        const Link& l = m_links[LinkId(link)];
+        return l.device[Side(l, node)];
+    }
+    uint32_t GetInterfaceIndex(const std::string& node, const std::string& link) const
+    {
+        const Link& l = m_links[LinkId(link)];
+        return l.ifIndex[Side(l, node)];
+    }
+    Ipv4Address GetAddress(const std::string& node, const std::string& link) const
+    {
+        const Link& l = m_links[LinkId(link)];
+        return Ipv4Address(l.address[Side(l, node)]);
+    }
+    Ipv4Address GetPeerAddress(const std::string& node, const std::string& link) const
+    {
+        const Link& l = m_links[LinkId(link)];
+        return Ipv4Address(l.address[1 - Side(l, node)]);
+    }
+    Ipv4Address GetSubnet(const std::string& link) const { return Ipv4Address(m_links[LinkId(link)].subnet); }
+    Ipv4Mask GetSubnetMask(const std::string& link) const { return Ipv4Mask(m_links[LinkId(link)].mask); }
+
+    // Any PointToPointHelper can enable PCAP on the devices built here
+    PointToPointHelper& GetPointToPointHelper() { return m_p2p; }
+
+private:
+    struct Link
+    {
+        std::string name;
+        uint32_t node[2];
+        Ptr<NetDevice> device[2];
+        uint32_t ifIndex[2];
+        uint32_t address[2];
+        uint32_t subnet;
+        uint32_t mask;
+    };
+
+    static uint32_t PrefixToMask(uint32_t len) { return len == 0 ? 0 : (0xffffffffu << (32 - len)); }
+
+    static void Tokenize(const std::string& line, std::vector<std::string>& tokens)
+    {
+        tokens.clear();
+        std::string::size_type end = line.find('#');
+        std::istringstream words(line.substr(0, end));
+        std::string word;
+        while (words >> word)
+        {
+            tokens.push_back(word);
+        }
+    }
+
+    // Splits key=value options starting at tokens[first]
+    void ParseOptions(const std::vector<std::string>& tokens, uint32_t first,
+                      std::unordered_map<std::string, std::string>& options) const
+    {
+        for (uint32_t i = first; i < tokens.size(); ++i)
+        {
+            std::string::size_type eq = tokens[i].find('=');
+            NS_ABORT_MSG_IF(eq == std::string::npos, "Topology line " << m_lineNo << ": expected key=value, got '" << tokens[i] << "'");
+            options[tokens[i].substr(0, eq)] = tokens[i].substr(eq + 1);
+        }
+    }
+
+    void ParsePrefix(const std::string& text, uint32_t& address, uint32_t& mask) const
+    {
+        std::string::size_type slash = text.find('/');
+        NS_ABORT_MSG_IF(slash == std::string::npos, "Topology line " << m_lineNo << ": expected prefix/len, got '" << text << "'");
+        uint32_t len = std::stoul(text.substr(slash + 1));
+        NS_ABORT_MSG_IF(len > 32, "Topology line " << m_lineNo << ": bad prefix length in '" << text << "'");
+        mask = PrefixToMask(len);
+        address = Ipv4Address(text.substr(0, slash).c_str()).Get() & mask;
+    }
+
+    uint32_t NodeId(const std::string& name) const
+    {
+        std::unordered_map<std::string, uint32_t>::const_iterator it = m_nodeIds.find(name);
+        NS_ABORT_MSG_IF(it == m_nodeIds.end(), "Topology: unknown node '" << name << "'");
+        return it->second;
+    }
+
+    uint32_t LinkId(const std::string& name) const
+    {
+        std::unordered_map<std::string, uint32_t>::const_iterator it = m_linkIds.find(name);
+        NS_ABORT_MSG_IF(it == m_linkIds.end(), "Topology: unknown link '" << name << "'");
+        return it->second;
+    }
+
+    uint32_t Side(const Link& link, const std::string& node) const
+    {
+        uint32_t id = NodeId(node);
+        NS_ABORT_MSG_IF(link.node[0] != id && link.node[1] != id, "Topology: node '" << node << "' is not on link '" << link.name << "'");
+        return link.node[0] == id ? 0 : 1;
+    }
+
+    void ParsePool(const std::vector<std::string>& tokens)
+    {
+        NS_ABORT_MSG_IF(tokens.size() != 3, "Topology line " << m_lineNo << ": usage: pool <prefix/len> <linkLen>");
+        uint32_t address, mask;
+        ParsePrefix(tokens[1], address, mask);
+        uint32_t len = 0;
+        while (len < 32 && (mask & (0x80000000u >> len))) {
+            ++len;
+        }
+        SetSubnetPool(Ipv4Address(address), len, std::stoul(tokens[2]));
+    }
+
+    void ParseDefaults(const std::vector<std::string>& tokens)
+    {
+        std::unordered_map<std::string, std::string> options;
+        ParseOptions(tokens, 1, options);
+        ApplyLinkOptions(options, m_rate, m_delay, m_queue, m_qdisc);
+    }
+
+    void ApplyLinkOptions(const std::unordered_map<std::string, std::string>& options, std::string& rate,
+                          std::string& delay, std::string& queue, std::string& qdisc) const
+    {
+        for (std::unordered_map<std::string, std::string>::const_iterator it = options.begin(); it != options.end(); ++it)
+        {
+            if (it->first == "rate") {
+                rate = it->second;
+            } else if (it->first == "delay") {
+                delay = it->second;
+            } else if (it->first == "queue") {
+                queue = it->second;
+            } else if (it->first == "qdisc") {
+                qdisc = it->second;
+            } else if (it->first != "subnet") {
+                NS_FATAL_ERROR("Topology line " << m_lineNo << ": unknown link option '" << it->first << "'");
+            }
+        }
+    }
+
+    void ParseNode(const std::vector<std::string>& tokens)
+    {
+        NS_ABORT_MSG_IF(tokens.size() < 2, "Topology line " << m_lineNo << ": usage: node <name> [x=X y=Y] [site=S]");
+        NS_ABORT_MSG_IF(m_nodeIds.count(tokens[1]), "Topology line " << m_lineNo << ": duplicate node '" << tokens[1] << "'");
+        std::unordered_map<std::string, std::string> options;
+        ParseOptions(tokens, 2, options);
+
+        uint32_t site = options.count("site") ? std::stoul(options["site"]) : 0;
+        Ptr<Node> node = CreateObject<Node>(site % m_systems);
+        m_stack.Install(node);
+        if (options.count("x") || options.count("y")) {
+            Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel>();
+            mobility->SetPosition(Vector(options.count("x") ? std::stod(options["x"]) : 0.0,
+                                         options.count("y") ? std::stod(options["y"]) : 0.0, 0.0));
+            node->AggregateObject(mobility);
+        }
+        m_nodeIds[tokens[1]] = m_nodes.GetN();
+        m_nodes.Add(node);
+    }
+
+    void ParseLink(const std::vector<std::string>& tokens)
+    {
+        NS_ABORT_MSG_IF(tokens.size() < 4, "Topology line " << m_lineNo << ": usage: link <name> <nodeA> <nodeB> [options]");
+        NS_ABORT_MSG_IF(m_linkIds.count(tokens[1]), "Topology line " << m_lineNo << ": duplicate link '" << tokens[1] << "'");
+        std::unordered_map<std::string, std::string> options;
+        ParseOptions(tokens, 4, options);
+        std::string rate = m_rate, delay = m_delay, queue = m_queue, qdisc = m_qdisc;
+        ApplyLinkOptions(options, rate, delay, queue, qdisc);
+
+        Link link;
+        link.name = tokens[1];
+        link.node[0] = NodeId(tokens[2]);
+        link.node[1] = NodeId(tokens[3]);
+
+        m_p2p.SetDeviceAttribute("DataRate", StringValue(rate));
+        m_p2p.SetChannelAttribute("Delay", StringValue(delay));
+        if (!queue.empty()) {
+            m_p2p.SetQueue("ns3::DropTailQueue<Packet>", "MaxSize", StringValue(queue));
+        } else {
+            m_p2p.SetQueue("ns3::DropTailQueue<Packet>");
+        }
+        NetDeviceContainer devices = m_p2p.Install(m_nodes.Get(link.node[0]), m_nodes.Get(link.node[1]));
+
+        if (options.count("subnet")) {
+            ParsePrefix(options["subnet"], link.subnet, link.mask);
+            NS_ABORT_MSG_IF(link.mask > PrefixToMask(30), "Topology line " << m_lineNo << ": link subnet must be /30 or larger");
+        } else {
+            link.subnet = AllocateSubnet();
+            link.mask = m_poolMask;
+        }
+        NS_ABORT_MSG_IF(SubnetOverlaps(link.subnet, link.mask),
+                        "Topology line " << m_lineNo << ": subnet of link '" << link.name << "' overlaps one already in use");
+        m_usedSubnets[link.subnet] = link.subnet | ~link.mask;
+
+        for (uint32_t side = 0; side < 2; ++side)
+        {
+            link.device[side] = devices.Get(side);
+            link.address[side] = link.subnet + side + 1;
+            link.ifIndex[side] = AssignAddress(devices.Get(side), link.address[side], link.mask, qdisc);
+        }
+
+        m_linkIds[link.name] = m_links.size();
+        m_links.push_back(link);
+    }
+
+    // Equivalent of Ipv4AddressHelper::Assign for one device, without the global
+    // address generator's duplicate bookkeeping
+    uint32_t AssignAddress(Ptr<NetDevice> device, uint32_t address, uint32_t mask, const std::string& qdisc)
+    {
+        Ptr<Ipv4> ipv4 = device->GetNode()->GetObject<Ipv4>();
+        int32_t ifIndex = ipv4->GetInterfaceForDevice(device);
+        if (ifIndex == -1) {
+            ifIndex = ipv4->AddInterface(device);
+        }
+        ipv4->AddAddress(ifIndex, Ipv4InterfaceAddress(Ipv4Address(address), Ipv4Mask(mask)));
+        ipv4->SetMetric(ifIndex, 1);
+        ipv4->SetUp(ifIndex);
+
+        if (qdisc != "none") {
+            Ptr<TrafficControlLayer> tc = device->GetNode()->GetObject<TrafficControlLayer>();
+            if (tc && !tc->GetRootQueueDiscOnDevice(device)) {
+                if (qdisc == "default") {
+                    TrafficControlHelper::Default().Install(device);
+                } else {
+                    TrafficControlHelper tch;
+                    tch.SetRootQueueDisc(qdisc);
+                    tch.Install(device);
+                }
+            }
+        }
+        return ifIndex;
+    }
+
+    // True if [base, base | ~mask] shares an address with a subnet in use. The
+    // ranges in use never overlap, so only the last one starting inside or
+    // before the candidate's end can reach into it.
+    bool SubnetOverlaps(uint32_t base, uint32_t mask) const
+    {
+        std::map<uint32_t, uint32_t>::const_iterator it = m_usedSubnets.upper_bound(base | ~mask);
+        return it != m_usedSubnets.begin() && (--it)->second >= base;
+    }
+
+    // The cursor only moves forward, so allocation is amortized O(1) per link
+    uint32_t AllocateSubnet()
+    {
+        while (m_poolNext <= m_poolLast && SubnetOverlaps(static_cast<uint32_t>(m_poolNext), m_poolMask)) {
+            m_poolNext += m_poolStep;
+        }
+        NS_ABORT_MSG_IF(m_poolNext > m_poolLast, "Topology line " << m_lineNo << ": subnet pool exhausted");
+        uint32_t subnet = static_cast<uint32_t>(m_poolNext);
+        m_poolNext += m_poolStep;
+        return subnet;
+    }
+
+    void ParseRoute(const std::vector<std::string>& tokens)
+    {
+        NS_ABORT_MSG_IF(tokens.size() < 5 || tokens[3] != "via",
+                        "Topology line " << m_lineNo << ": usage: route <node> <prefix/len>|default via <link> [metric=M]");
+        std::unordered_map<std::string, std::string> options;
+        ParseOptions(tokens, 5, options);
+        uint32_t metric = options.count("metric") ? std::stoul(options["metric"]) : 0;
+
+        uint32_t dest = 0, mask = 0;
+        if (tokens[2] != "default") {
+            ParsePrefix(tokens[2], dest, mask);
+        }
+
+        Ptr<Ipv4> ipv4 = GetNode(tokens[1])->GetObject<Ipv4>();
+        Ptr<Ipv4StaticRouting> routing = m_staticHelper.GetStaticRouting(ipv4);
+        NS_ABORT_MSG_IF(!routing, "Topology line " << m_lineNo << ": node '" << tokens[1] << "' has no static routing");
+        routing->AddNetworkRouteTo(Ipv4Address(dest), Ipv4Mask(mask), GetPeerAddress(tokens[1], tokens[4]),
+                                   GetInterfaceIndex(tokens[1], tokens[4]), metric);
+    }
+
+    NodeContainer m_nodes;
+    std::unordered_map<std::string, uint32_t> m_nodeIds;
+    std::vector<Link> m_links;
+    std::unordered_map<std::string, uint32_t> m_linkIds;
+    std::map<uint32_t, uint32_t> m_usedSubnets;     // First -> last address of every link subnet
+
+    uint64_t m_poolNext;        // 64-bit so the cursor cannot wrap past the pool end
+    uint64_t m_poolLast;
+    uint32_t m_poolStep;
+    uint32_t m_poolMask;
+
+    std::string m_rate;
+    std::string m_delay;
+    std::string m_queue;
+    std::string m_qdisc;
+    uint32_t m_lineNo;
+    uint32_t m_systems;
+    uint32_t m_localSystem;
+
+    InternetStackHelper m_stack;
+    Ipv4StaticRoutingHelper m_staticHelper;
+    PointToPointHelper m_p2p;
+};
+
+} // namespace ns3
+
+#endif /* WAN_TOPOLOGY_H */